@@ -0,0 +1,204 @@
+/**
+ * Echo throughput and latency benchmark, run it against samples/echo_server.
+ * Every connection sends a message, waits for the whole echo, then sends the next one.
+ * usage: echo_client <server_ip> <port> [-c connections] [-s message_size] [-t seconds]
+ * output: one JSON object.
+ */
+#include "../sw_event.h"
+#include "../sw_util.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Conn
+{
+    int     fd;
+    int     sent;
+    int     received;
+    int64_t send_time; /* us */
+};
+
+static sw_ev_context_t * ctx = NULL;
+static int      message_size = 64;
+static char   * message = NULL;
+static uint64_t messages = 0;
+static int64_t *latencies = NULL; /* us */
+static uint64_t latencies_count = 0;
+static uint64_t latencies_capacity = 0;
+
+static void OnIOReady(int fd, int events, void *arg);
+
+static void RecordLatency(int64_t usec)
+{
+    if (latencies_count == latencies_capacity)
+    {
+        latencies_capacity = latencies_capacity ? latencies_capacity * 2 : 65536;
+        latencies = (int64_t *)realloc(latencies, latencies_capacity * sizeof(int64_t));
+    }
+    latencies[latencies_count++] = usec;
+}
+
+static int CompareLatency(const void *left, const void *right)
+{
+    int64_t l = *(const int64_t *)left, r = *(const int64_t *)right;
+    return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+static void SendMessage(struct Conn *conn)
+{
+    int ret;
+    if (0 == conn->sent)
+    {
+        conn->send_time = sw_ev_gettime_us();
+    }
+    while (conn->sent < message_size)
+    {
+        ret = send(conn->fd, message + conn->sent, message_size - conn->sent, 0);
+        if (ret > 0)
+        {
+            conn->sent += ret;
+        }
+        else if (ret < 0 && SW_ERRNO == EINTR)
+        {
+            continue;
+        }
+        else if (ret < 0 && SW_ERRNO == EAGAIN)
+        {
+            sw_ev_io_add(ctx, conn->fd, SW_EV_WRITE, OnIOReady, conn);
+            return;
+        }
+        else
+        {
+            fprintf(stderr, "send: %d\n", SW_ERRNO);
+            exit(1);
+        }
+    }
+    sw_ev_io_del(ctx, conn->fd, SW_EV_WRITE);
+}
+
+static void OnIOReady(int fd, int events, void *arg)
+{
+    struct Conn *conn = (struct Conn *)arg;
+    char buf[65536];
+    int ret;
+    if (events & SW_EV_READ)
+    {
+        while (1)
+        {
+            ret = recv(fd, buf, sizeof(buf), 0);
+            if (ret > 0)
+            {
+                conn->received += ret;
+                if (conn->received >= message_size)
+                {
+                    RecordLatency(sw_ev_gettime_us() - conn->send_time);
+                    ++messages;
+                    conn->received -= message_size;
+                    conn->sent = 0;
+                    SendMessage(conn);
+                }
+                continue;
+            }
+            else if (ret < 0 && SW_ERRNO == EINTR)
+            {
+                continue;
+            }
+            else if (ret < 0 && SW_ERRNO == EAGAIN)
+            {
+                break;
+            }
+            fprintf(stderr, "connection closed by server\n");
+            exit(1);
+        }
+    }
+    if (events & SW_EV_WRITE)
+    {
+        SendMessage(conn);
+    }
+}
+
+static void OnDeadline(void *arg)
+{
+    sw_ev_loop_exit(ctx);
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_in addr;
+    struct Conn *conns;
+    int connections = 10;
+    int seconds = 5;
+    int64_t begin, usec;
+    int opt, i, nodelay = 1;
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <server_ip> <port> [-c connections] [-s message_size] [-t seconds]\n",
+                argv[0]);
+        return 1;
+    }
+    optind = 3;
+    while ((opt = getopt(argc, argv, "c:s:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': connections = atoi(optarg); break;
+        case 's': message_size = atoi(optarg); break;
+        case 't': seconds = atoi(optarg); break;
+        default: return 1;
+        }
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(argv[1]);
+    addr.sin_port = htons(atoi(argv[2]));
+    message = (char *)malloc(message_size);
+    memset(message, 'e', message_size);
+    ctx = sw_ev_context_new();
+    conns = (struct Conn *)calloc(connections, sizeof(struct Conn));
+    for (i = 0; i < connections; ++i)
+    {
+        conns[i].fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (-1 == connect(conns[i].fd, (struct sockaddr *)&addr, sizeof(addr)))
+        {
+            perror("connect");
+            return 1;
+        }
+        setsockopt(conns[i].fd, IPPROTO_TCP, TCP_NODELAY, (char *)&nodelay, sizeof(nodelay));
+        sw_ev_setnonblock(conns[i].fd);
+        sw_ev_io_add(ctx, conns[i].fd, SW_EV_READ, OnIOReady, &conns[i]);
+    }
+    sw_ev_timer_add(ctx, seconds * 1000, OnDeadline, NULL);
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < connections; ++i)
+    {
+        SendMessage(&conns[i]);
+    }
+    sw_ev_loop(ctx);
+    usec = sw_ev_gettime_us() - begin;
+    qsort(latencies, latencies_count, sizeof(int64_t), CompareLatency);
+    printf("{\"bench\":\"echo\",\"connections\":%d,\"message_size\":%d,\"usec\":%lld,"
+           "\"messages\":%llu,\"messages_per_sec\":%.0f,\"mbytes_per_sec\":%.2f,"
+           "\"latency_p50_us\":%lld,\"latency_p99_us\":%lld,\"latency_max_us\":%lld}\n",
+           connections, message_size, (long long)usec, (unsigned long long)messages,
+           messages * 1000000.0 / usec, messages * (double)message_size / usec,
+           latencies_count ? (long long)latencies[latencies_count / 2] : 0LL,
+           latencies_count ? (long long)latencies[latencies_count * 99 / 100] : 0LL,
+           latencies_count ? (long long)latencies[latencies_count - 1] : 0LL);
+    for (i = 0; i < connections; ++i)
+    {
+        sw_ev_io_del(ctx, conns[i].fd, SW_EV_READ | SW_EV_WRITE);
+        close(conns[i].fd);
+    }
+    free(conns);
+    free(message);
+    free(latencies);
+    sw_ev_context_free(ctx);
+    return 0;
+}
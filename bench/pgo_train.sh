@@ -0,0 +1,19 @@
+#!/bin/sh
+# Short runs of the benchmarks and the echo sample, as the training workload of make pgo.
+# usage: bench/pgo_train.sh [echo_port]
+cd "$(dirname "$0")/.." || exit 1
+PORT=${1:-19528}
+
+./bench/pingpong -n 100 -a 1 -w 100000 -r 1 > /dev/null
+./bench/pingpong -n 1000 -a 100 -w 300000 -r 1 > /dev/null
+SW_EV_BACKEND=poll ./bench/pingpong -n 100 -a 10 -w 100000 -r 1 > /dev/null
+./bench/timer_churn 300000 > /dev/null
+
+./samples/echo_server 127.0.0.1 "$PORT" > /dev/null &
+SERVER_PID=$!
+sleep 1
+./bench/echo_client 127.0.0.1 "$PORT" -c 1 -s 64 -t 1 > /dev/null
+./bench/echo_client 127.0.0.1 "$PORT" -c 100 -s 64 -t 1 > /dev/null
+./bench/echo_client 127.0.0.1 "$PORT" -c 20 -s 16384 -t 1 > /dev/null
+kill -INT "$SERVER_PID"
+wait "$SERVER_PID"
@@ -0,0 +1,141 @@
+/**
+ * Ping-pong benchmark, similar to libevent's test/bench.c.
+ * Create N socketpairs, M of them are active writers. Every byte read from a
+ * pair is written to the next pair, until the total writes count reached.
+ * usage: pingpong [-n pipes] [-a active] [-w writes] [-r runs]
+ * output: one JSON object per run.
+ */
+#include "../sw_event.h"
+#include "../sw_util.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static sw_ev_context_t * ctx = NULL;
+static int  num_pipes = 100;
+static int  num_active = 1;
+static int  num_writes = 100000;
+static int *pipes = NULL;
+static int  writes_left = 0;
+static int  fired = 0;
+
+static void OnRead(int fd, int events, void *arg)
+{
+    int index = (int)(intptr_t)arg;
+    char buf[64];
+    int ret, i;
+    while (1)
+    {
+        ret = recv(fd, buf, sizeof(buf), 0);
+        if (ret > 0)
+        {
+            for (i = 0; i < ret; ++i)
+            {
+                ++fired;
+                if (writes_left > 0)
+                {
+                    int next = (index + 1) % num_pipes;
+                    --writes_left;
+                    send(pipes[2 * next + 1], "e", 1, 0);
+                }
+            }
+            if (writes_left <= 0 && fired >= num_writes + num_active)
+            {
+                sw_ev_loop_exit(ctx);
+            }
+            continue;
+        }
+        if (ret < 0 && SW_ERRNO == EINTR)
+        {
+            continue;
+        }
+        break;
+    }
+}
+
+static int64_t RunOnce(void)
+{
+    int64_t begin;
+    int i;
+    fired = 0;
+    writes_left = num_writes;
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < num_active; ++i)
+    {
+        send(pipes[2 * (i * num_pipes / num_active) + 1], "e", 1, 0);
+    }
+    sw_ev_loop(ctx);
+    return sw_ev_gettime_us() - begin;
+}
+
+int main(int argc, char **argv)
+{
+    struct rlimit rl;
+    int num_runs = 5;
+    int opt, i;
+    while ((opt = getopt(argc, argv, "n:a:w:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': num_pipes = atoi(optarg); break;
+        case 'a': num_active = atoi(optarg); break;
+        case 'w': num_writes = atoi(optarg); break;
+        case 'r': num_runs = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n pipes] [-a active] [-w writes] [-r runs]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_pipes <= 0 || num_active <= 0 || num_active > num_pipes)
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+    if (0 == getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < (rlim_t)num_pipes * 2 + 64)
+    {
+        rl.rlim_cur = (rlim_t)num_pipes * 2 + 64;
+        if (rl.rlim_cur > rl.rlim_max)
+        {
+            rl.rlim_cur = rl.rlim_max;
+        }
+        if (-1 == setrlimit(RLIMIT_NOFILE, &rl))
+        {
+            perror("setrlimit");
+        }
+    }
+    ctx = sw_ev_context_new();
+    pipes = (int *)malloc(sizeof(int) * 2 * num_pipes);
+    for (i = 0; i < num_pipes; ++i)
+    {
+        if (-1 == sw_ev_socketpair(&pipes[2 * i]))
+        {
+            perror("socketpair");
+            return 1;
+        }
+        sw_ev_setnonblock(pipes[2 * i]);
+        sw_ev_setnonblock(pipes[2 * i + 1]);
+        sw_ev_io_add(ctx, pipes[2 * i], SW_EV_READ, OnRead, (void *)(intptr_t)i);
+    }
+    for (i = 0; i < num_runs; ++i)
+    {
+        int64_t usec = RunOnce();
+        printf("{\"bench\":\"pingpong\",\"pipes\":%d,\"active\":%d,\"writes\":%d,\"run\":%d,"
+               "\"usec\":%lld,\"events_per_sec\":%.0f}\n",
+               num_pipes, num_active, num_writes, i, (long long)usec,
+               usec > 0 ? fired * 1000000.0 / usec : 0.0);
+    }
+    for (i = 0; i < num_pipes; ++i)
+    {
+        sw_ev_io_del(ctx, pipes[2 * i], SW_EV_READ);
+        close(pipes[2 * i]);
+        close(pipes[2 * i + 1]);
+    }
+    free(pipes);
+    sw_ev_context_free(ctx);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Run all benchmarks with default parameters, print one JSON object per line.
+# usage: bench/run_all.sh [echo_port]
+cd "$(dirname "$0")/.." || exit 1
+PORT=${1:-19527}
+
+./bench/pingpong -n 100 -a 1 -w 100000 -r 3
+./bench/pingpong -n 1000 -a 100 -w 1000000 -r 3
+./bench/pingpong -n 5000 -a 500 -w 1000000 -r 3
+./bench/timer_churn 1000000
+./bench/timer_heap 1000000
+
+./samples/echo_server 127.0.0.1 "$PORT" > /dev/null &
+SERVER_PID=$!
+sleep 1
+./bench/echo_client 127.0.0.1 "$PORT" -c 1 -s 64 -t 3
+./bench/echo_client 127.0.0.1 "$PORT" -c 100 -s 64 -t 3
+./bench/echo_client 127.0.0.1 "$PORT" -c 100 -s 16384 -t 3
+kill "$SERVER_PID"
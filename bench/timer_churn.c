@@ -0,0 +1,80 @@
+/**
+ * Timer churn benchmark.
+ * For every timers count, measure the cost of adding N timers with random timeouts,
+ * cancelling half of them, and expiring the rest through the event loop. The
+ * expire cost excludes the time blocked in poll-wait.
+ * usage: timer_churn [max_timers]   (default 1000000, counts are 10^3 ... max)
+ * output: one JSON object per timers count.
+ */
+#include "../sw_event.h"
+#include "../sw_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static sw_ev_context_t * ctx = NULL;
+static sw_ev_timer_t ** timers = NULL;
+static int expired = 0;
+static int expect_expired = 0;
+
+static void OnTimer(void *arg)
+{
+    int index = (int)(intptr_t)arg;
+    sw_ev_timer_del(ctx, timers[index]);
+    timers[index] = NULL;
+    if (++expired == expect_expired)
+    {
+        sw_ev_loop_exit(ctx);
+    }
+}
+
+static void RunOnce(int count)
+{
+    sw_ev_stats_t stats;
+    int64_t begin, add_usec, del_usec, loop_usec;
+    int i;
+    ctx = sw_ev_context_new();
+    timers = (sw_ev_timer_t **)malloc(sizeof(sw_ev_timer_t *) * count);
+
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < count; ++i)
+    {
+        /* spread expire time over [1, 200]ms */
+        timers[i] = sw_ev_timer_add(ctx, 1 + rand() % 200, OnTimer, (void *)(intptr_t)i);
+    }
+    add_usec = sw_ev_gettime_us() - begin;
+
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < count; i += 2)
+    {
+        sw_ev_timer_del(ctx, timers[i]);
+        timers[i] = NULL;
+    }
+    del_usec = sw_ev_gettime_us() - begin;
+
+    expired = 0;
+    expect_expired = count / 2;
+    begin = sw_ev_gettime_us();
+    sw_ev_loop(ctx);
+    loop_usec = sw_ev_gettime_us() - begin;
+    sw_ev_context_stats(ctx, &stats);
+
+    printf("{\"bench\":\"timer_churn\",\"timers\":%d,\"add_ns\":%.1f,\"cancel_ns\":%.1f,"
+           "\"expire_ns\":%.1f,\"lateness_max_ms\":%lld}\n",
+           count, add_usec * 1000.0 / count, del_usec * 2000.0 / count,
+           (loop_usec - stats.poll_wait_time) * 1000.0 / expect_expired,
+           (long long)stats.timer_lateness_max);
+    sw_ev_context_free(ctx);
+    free(timers);
+}
+
+int main(int argc, char **argv)
+{
+    int max_timers = argc > 1 ? atoi(argv[1]) : 1000000;
+    int count;
+    srand(1);
+    for (count = 1000; count <= max_timers; count *= 10)
+    {
+        RunOnce(count);
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * Timer heap microbenchmark, compare the binary heap of timer pointers (sw_timer_heap.h)
+ * with the 4-ary heap of inline {expire_time, timer} entries (sw_timer_heap4.h).
+ * Every timer is allocated separately like sw_ev_timer_add() does.
+ * usage: timer_heap [max_timers]   (default 1000000, counts are 10^3 ... max)
+ * output: one JSON object per layout and timers count.
+ */
+#include "timer_heap.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static void InitTimers(sw_ev_timer_t **timers, int count)
+{
+    int i;
+    srand(count);
+    for (i = 0; i < count; ++i)
+    {
+        timers[i]->index_in_heap = -1;
+        /* low bits keep expire times unique, so both layouts pop the same order */
+        timers[i]->interval = (1 + rand() % 1000) << 20;
+        timers[i]->next_expire_time = ((int64_t)(rand() % 60000) << 20) | i;
+    }
+}
+
+static void Report(const char *layout, int count, const bench_heap_result_t *result)
+{
+    printf("{\"bench\":\"timer_heap\",\"layout\":\"%s\",\"timers\":%d,\"push_ns\":%.1f,"
+           "\"reschedule_ns\":%.1f,\"erase_ns\":%.1f,\"pop_ns\":%.1f,\"checksum\":%lld}\n",
+           layout, count, result->push_ns, result->reschedule_ns, result->erase_ns,
+           result->pop_ns, (long long)result->checksum);
+}
+
+int main(int argc, char **argv)
+{
+    int max_timers = argc > 1 ? atoi(argv[1]) : 1000000;
+    sw_ev_timer_t **timers;
+    bench_heap_result_t result;
+    int count, i;
+    for (count = 1000; count <= max_timers; count *= 10)
+    {
+        timers = (sw_ev_timer_t **)malloc(sizeof(sw_ev_timer_t *) * count);
+        for (i = 0; i < count; ++i)
+        {
+            timers[i] = (sw_ev_timer_t *)malloc(sizeof(sw_ev_timer_t));
+        }
+        InitTimers(timers, count);
+        bench_heap2_run(timers, count, &result);
+        Report("binary", count, &result);
+        InitTimers(timers, count);
+        bench_heap4_run(timers, count, &result);
+        Report("4ary_inline", count, &result);
+        for (i = 0; i < count; ++i)
+        {
+            free(timers[i]);
+        }
+        free(timers);
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef INC_BENCH_TIMER_HEAP_H
+#define INC_BENCH_TIMER_HEAP_H
+
+#include "../sw_event.h"
+
+typedef struct bench_heap_result
+{
+    double  push_ns;
+    double  reschedule_ns;
+    double  erase_ns;
+    double  pop_ns;
+    int64_t checksum; /* both layouts must produce the same value */
+} bench_heap_result_t;
+
+void bench_heap2_run(sw_ev_timer_t **timers, int count, bench_heap_result_t *result);
+void bench_heap4_run(sw_ev_timer_t **timers, int count, bench_heap_result_t *result);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * Timer heap operations measured by bench/timer_heap.c. This file is compiled twice,
+ * with and without SW_EV_TIMER_HEAP4, to get both heap layouts in one program.
+ */
+#include "../sw_timer_heap.h"
+#include "../sw_util.h"
+#include <stdlib.h>
+#include "timer_heap.h"
+
+#ifdef SW_EV_TIMER_HEAP4
+#define BENCH_HEAP_RUN bench_heap4_run
+#else
+#define BENCH_HEAP_RUN bench_heap2_run
+#endif
+
+void BENCH_HEAP_RUN(sw_ev_timer_t **timers, int count, bench_heap_result_t *result)
+{
+    sw_timer_heap_t heap;
+    sw_ev_timer_t *timer;
+    int64_t begin;
+    int64_t checksum = 0;
+    int i;
+
+    sw_timer_heap_ctor(&heap);
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < count; ++i)
+    {
+        sw_timer_heap_push(&heap, timers[i]);
+    }
+    result->push_ns = (sw_ev_gettime_us() - begin) * 1000.0 / count;
+
+    /* what process_timers_ does: pop the top, move its expire time, push it again */
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < count; ++i)
+    {
+        timer = sw_timer_heap_pop(&heap);
+        timer->next_expire_time += timer->interval;
+        sw_timer_heap_push(&heap, timer);
+    }
+    result->reschedule_ns = (sw_ev_gettime_us() - begin) * 1000.0 / count;
+
+    begin = sw_ev_gettime_us();
+    for (i = 0; i < count; i += 2)
+    {
+        sw_timer_heap_erase(&heap, timers[i]);
+    }
+    result->erase_ns = (sw_ev_gettime_us() - begin) * 2000.0 / count;
+
+    begin = sw_ev_gettime_us();
+    while (NULL != (timer = sw_timer_heap_pop(&heap)))
+    {
+        checksum += timer->next_expire_time;
+    }
+    result->pop_ns = (sw_ev_gettime_us() - begin) * 2000.0 / count;
+    result->checksum = checksum;
+    sw_timer_heap_dtor(&heap);
+}
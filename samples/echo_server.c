@@ -19,12 +19,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <signal.h>
+
+#ifdef _WIN32
+#define CLOSESOCKET(s)  closesocket(s)
+#define SOCKET_ERRNO    WSAGetLastError()
+#else
+#define CLOSESOCKET(s)  close(s)
+#define SOCKET_ERRNO    errno
+#endif
 
 struct sw_ev_context * ctx = NULL;
 struct sw_ev_timer *timer = NULL;
 
 void OnIOReady(int fd, int events, void * arg);
 
+int SetNonBlock(int fd)
+{
+#ifdef _WIN32
+    unsigned long nonblocking = 1;
+    return ioctlsocket(fd, FIONBIO, &nonblocking);
+#else
+    int flags = fcntl(fd, F_GETFL);
+    return -1 == flags ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
 struct SendBuf
 {
     char *buf;
@@ -70,7 +90,7 @@ void EndSession(struct Session *pSession)
 {
     struct SendBuf *pTmp, *pNext;
     sw_ev_io_del(ctx, pSession->fd, SW_EV_READ | SW_EV_WRITE);
-    SW_EV_CLOSESOCKET(pSession->fd);
+    CLOSESOCKET(pSession->fd);
     pSession->fd = -1;
     for (pNext = pSession->sendHead; pNext != NULL; )
     {
@@ -114,11 +134,11 @@ resend:
         else
         {
 #ifdef _WIN32
-            if (SW_ERRNO == WSAEINTR) goto resend;
-            else if (SW_ERRNO == WSAEWOULDBLOCK)
+            if (SOCKET_ERRNO == WSAEINTR) goto resend;
+            else if (SOCKET_ERRNO == WSAEWOULDBLOCK)
 #else
-            if (SW_ERRNO == EINTR) goto resend;
-            else if (SW_ERRNO == EWOULDBLOCK)
+            if (SOCKET_ERRNO == EINTR) goto resend;
+            else if (SOCKET_ERRNO == EWOULDBLOCK)
 #endif
             {
                 if (-1 == sw_ev_io_add(ctx, pSession->fd, SW_EV_WRITE, OnIOReady, pSession))
@@ -159,6 +179,11 @@ void OnIOReady(int fd, int events, void * arg)
     char buf[1024];
     assert(pSession);
     assert(fd == pSession->fd);
+    if (events & SW_EV_ERROR) /* connection reset, needn't recv() to find it */
+    {
+        EndSession(pSession);
+        return;
+    }
     if (events & SW_EV_READ)
     {
         int ret;
@@ -173,11 +198,11 @@ void OnIOReady(int fd, int events, void * arg)
             else if (ret < 0)
             {
 #ifdef _WIN32
-                if(SW_ERRNO == WSAEINTR)    continue;
-                else if (SW_ERRNO != WSAEWOULDBLOCK)
+                if(SOCKET_ERRNO == WSAEINTR)    continue;
+                else if (SOCKET_ERRNO != WSAEWOULDBLOCK)
 #else
-                if (SW_ERRNO == EINTR)    continue;
-                else if (SW_ERRNO != EAGAIN)
+                if (SOCKET_ERRNO == EINTR)    continue;
+                else if (SOCKET_ERRNO != EAGAIN)
 #endif
                 {
                     EndSession(pSession);
@@ -220,7 +245,7 @@ void OnAcceptReady(int fd, int events, void * arg)
         if (client >= 0)
         {
             printf("fd=%d, client=%d\n", fd, client);
-            sw_ev_setnonblock(client);
+            SetNonBlock(client);
             pSession = (struct Session *)malloc(sizeof(struct Session));
             assert(pSession);
             pSession->fd = client;
@@ -233,15 +258,15 @@ void OnAcceptReady(int fd, int events, void * arg)
             }
         }
 #ifdef _WIN32
-        else if (SW_ERRNO == WSAEINTR)    continue;
-        else if (SW_ERRNO == WSAEWOULDBLOCK)    break;
+        else if (SOCKET_ERRNO == WSAEINTR)    continue;
+        else if (SOCKET_ERRNO == WSAEWOULDBLOCK)    break;
 #else
-        else if (SW_ERRNO == EINTR)    continue;
-        else if (SW_ERRNO == EAGAIN)    break;
+        else if (SOCKET_ERRNO == EINTR)    continue;
+        else if (SOCKET_ERRNO == EAGAIN)    break;
 #endif
         else // listen socket occur error
         {
-            printf("accept: %d\n", SW_ERRNO);
+            printf("accept: %d\n", SOCKET_ERRNO);
             exit(1);
         }
     }
@@ -279,14 +304,19 @@ void BindAndListen(const char *ip, unsigned short port)
         perror("listen");
         exit(1);
     }
-    sw_ev_setnonblock(listenSock);
+    SetNonBlock(listenSock);
     if (-1 == sw_ev_io_add(ctx, listenSock, SW_EV_READ, OnAcceptReady, NULL))
     {
         printf("sw_ev_io_add failed\n");
-        SW_EV_CLOSESOCKET(listenSock);
+        CLOSESOCKET(listenSock);
     }
 }
 
+void OnStopSignal(int sig_no, void *arg)
+{
+    sw_ev_loop_exit(ctx);
+}
+
 int main(int argc, char **argv)
 {
 #ifdef _WIN32
@@ -304,6 +334,7 @@ int main(int argc, char **argv)
     }
     ctx = sw_ev_context_new();
     BindAndListen(argv[1], atoi(argv[2]));
+    sw_ev_signal_add(ctx, SIGINT, OnStopSignal, NULL);
     sw_ev_loop(ctx);
     sw_ev_context_free(ctx);
 #ifdef _WIN32
@@ -0,0 +1,90 @@
+/*
+ * echo_server.c written with C++20 coroutines, see sw_coro.hpp.
+ * usage: echo_server_coro <bind_ip> <port>
+ */
+#include "../sw_event.h"
+#include "../sw_coro.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static sw_ev_context_t *ctx = NULL;
+
+static int SetNonBlock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return -1 == flags ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+sw::task<> Session(int fd)
+{
+    char buf[4096];
+    long n;
+    while ((n = co_await sw::recv(ctx, fd, buf, sizeof(buf))) > 0)
+    {
+        if (co_await sw::send_all(ctx, fd, buf, n) < 0)
+        {
+            break;
+        }
+    }
+    close(fd);
+}
+
+sw::task<> Acceptor(int listenSock)
+{
+    while (true)
+    {
+        long client = co_await sw::accept(ctx, listenSock);
+        if (client < 0)
+        {
+            perror("accept");
+            sw_ev_loop_exit(ctx);
+            co_return;
+        }
+        SetNonBlock((int)client);
+        sw::spawn(Session((int)client));
+    }
+}
+
+void OnStopSignal(int sig_no, void *arg)
+{
+    sw_ev_loop_exit(ctx);
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_in serverAddr;
+    int reuse = 1;
+    int listenSock;
+    if (argc != 3)
+    {
+        printf("usage: %s <bind_ip> <port>\n", argv[0]);
+        exit(1);
+    }
+    ctx = sw_ev_context_new();
+    listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse));
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = inet_addr(argv[1]);
+    serverAddr.sin_port = htons(atoi(argv[2]));
+    if (-1 == bind(listenSock, (struct sockaddr *)&serverAddr, sizeof(serverAddr))
+        || -1 == listen(listenSock, 128))
+    {
+        perror("bind");
+        exit(1);
+    }
+    SetNonBlock(listenSock);
+    sw_ev_signal_add(ctx, SIGINT, OnStopSignal, NULL);
+    sw::spawn(Acceptor(listenSock));
+    sw_ev_loop(ctx);
+    close(listenSock);
+    sw_ev_context_free(ctx);
+    return 0;
+}
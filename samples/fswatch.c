@@ -0,0 +1,44 @@
+#include "../sw_event.h"
+#include "../sw_fswatch.h"
+#include <stdio.h>
+
+struct sw_ev_context * ctx = NULL;
+
+void OnChange(int wd, const char *path, const char *name, int events, void *arg)
+{
+    if (events & SW_EV_FS_OVERFLOW)
+    {
+        printf("event queue overflow, rescan needed\n");
+        return;
+    }
+    printf("wd=%d path=%s name=%s events=0x%x\n", wd, path, name ? name : "", events);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    sw_ev_fswatch_t *watcher;
+    if (argc < 2)
+    {
+        printf("usage: %s <path> [path...]\n", argv[0]);
+        return 1;
+    }
+    ctx = sw_ev_context_new();
+    watcher = sw_ev_fswatch_new(ctx, OnChange, NULL);
+    if (NULL == watcher)
+    {
+        printf("sw_ev_fswatch_new failed\n");
+        return 1;
+    }
+    for (i = 1; i < argc; ++i)
+    {
+        if (-1 == sw_ev_fswatch_add(watcher, argv[i], SW_EV_FS_ALL))
+        {
+            printf("sw_ev_fswatch_add %s failed\n", argv[i]);
+        }
+    }
+    sw_ev_loop(ctx);
+    sw_ev_fswatch_free(watcher);
+    sw_ev_context_free(ctx);
+    return 0;
+}
@@ -0,0 +1,195 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* accept4() */
+#endif
+#include "sw_acceptor.h"
+#include "sw_log.h"
+#include "sw_util.h"
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#define SW_EV_ACCEPTOR_EAGAIN(err)   ((err) == WSAEWOULDBLOCK)
+#define SW_EV_ACCEPTOR_RETRY(err)    ((err) == WSAEINTR || (err) == WSAECONNRESET)
+#define SW_EV_ACCEPTOR_NO_FDS(err)   ((err) == WSAEMFILE || (err) == WSAENOBUFS)
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#define SW_EV_ACCEPTOR_EAGAIN(err)   ((err) == EAGAIN || (err) == EWOULDBLOCK)
+#define SW_EV_ACCEPTOR_RETRY(err)    ((err) == EINTR || (err) == ECONNABORTED || (err) == EPROTO)
+#define SW_EV_ACCEPTOR_NO_FDS(err) \
+    ((err) == EMFILE || (err) == ENFILE || (err) == ENOBUFS || (err) == ENOMEM)
+#endif
+
+struct sw_ev_acceptor
+{
+    sw_ev_context_t   * ctx;
+    int                 listen_fd;
+    int                 budget;
+    sw_ev_accept_cb_t   on_accept;
+    void              * arg;
+    sw_ev_timer_t     * pause_timer; /* not NULL while paused */
+    int                 in_callback;
+    int                 freed;       /* freed in on_accept, released after it returns */
+    int                 fds[1];      /* elements count: budget */
+};
+
+static int
+sw_ev_acceptor_accept_(int listen_fd)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+    return accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int fd = (int)accept(listen_fd, NULL, NULL);
+    if (-1 != fd)
+    {
+        sw_ev_setnonblock(fd);
+#ifndef _WIN32
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    }
+    return fd;
+#endif
+}
+
+static void sw_ev_acceptor_ready_(int fd, int events, void *arg);
+
+static void
+sw_ev_acceptor_resume_(void *arg)
+{
+    sw_ev_acceptor_t *acceptor = (sw_ev_acceptor_t *)arg;
+    sw_ev_timer_del(acceptor->ctx, acceptor->pause_timer);
+    acceptor->pause_timer = NULL;
+    /* readiness of the pending connections is reported again when re-registered */
+    if (-1 == sw_ev_io_add(acceptor->ctx, acceptor->listen_fd, SW_EV_READ,
+                           sw_ev_acceptor_ready_, acceptor))
+    {
+        sw_log_error("%s:%d can't resume accepting on fd %d", __FILE__, __LINE__, acceptor->listen_fd);
+    }
+}
+
+static void
+sw_ev_acceptor_pause_(sw_ev_acceptor_t *acceptor, int err)
+{
+    acceptor->pause_timer = sw_ev_timer_add(acceptor->ctx, SW_EV_ACCEPTOR_PAUSE,
+                                            sw_ev_acceptor_resume_, acceptor);
+    if (NULL == acceptor->pause_timer)
+    {
+        return; /* keep watching, woken up again by the next connection */
+    }
+    sw_ev_io_del(acceptor->ctx, acceptor->listen_fd, SW_EV_READ);
+    sw_log_warn("%s:%d accept: %d, paused for %d ms", __FILE__, __LINE__, err, SW_EV_ACCEPTOR_PAUSE);
+}
+
+static void
+sw_ev_acceptor_ready_(int fd, int events, void *arg)
+{
+    sw_ev_acceptor_t *acceptor = (sw_ev_acceptor_t *)arg;
+    int count = 0;
+    int client;
+    int err;
+    while (count < acceptor->budget)
+    {
+        client = sw_ev_acceptor_accept_(fd);
+        if (-1 != client)
+        {
+            acceptor->fds[count++] = client;
+            continue;
+        }
+        err = SW_ERRNO;
+        if (SW_EV_ACCEPTOR_RETRY(err))
+        {
+            continue;
+        }
+        if (SW_EV_ACCEPTOR_NO_FDS(err))
+        {
+            sw_ev_acceptor_pause_(acceptor, err);
+        }
+        else if (!SW_EV_ACCEPTOR_EAGAIN(err))
+        {
+            sw_log_error("%s:%d accept: %d", __FILE__, __LINE__, err);
+        }
+        break;
+    }
+    if (count == acceptor->budget)
+    {
+        /* backlog not drained, re-register so edge triggered backends report it again */
+        sw_ev_io_add(acceptor->ctx, fd, SW_EV_READ, sw_ev_acceptor_ready_, acceptor);
+    }
+    if (count > 0)
+    {
+        acceptor->in_callback = 1;
+        acceptor->on_accept(acceptor->fds, count, acceptor->arg);
+        acceptor->in_callback = 0;
+        if (acceptor->freed)
+        {
+            sw_ev_free(acceptor);
+        }
+    }
+}
+
+sw_ev_acceptor_t *
+sw_ev_acceptor_new(sw_ev_context_t *ctx, int listen_fd, int budget,
+                   sw_ev_accept_cb_t on_accept, void *arg)
+{
+    sw_ev_acceptor_t *acceptor;
+    if (NULL == ctx || NULL == on_accept || budget < 0)
+    {
+        return NULL;
+    }
+    if (0 == budget)
+    {
+        budget = SW_EV_ACCEPTOR_BUDGET;
+    }
+    acceptor = (sw_ev_acceptor_t *)sw_ev_malloc(sizeof(sw_ev_acceptor_t) + (budget - 1) * sizeof(int));
+    if (NULL == acceptor)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(acceptor, 0, sizeof(sw_ev_acceptor_t));
+    acceptor->ctx = ctx;
+    acceptor->listen_fd = listen_fd;
+    acceptor->budget = budget;
+    acceptor->on_accept = on_accept;
+    acceptor->arg = arg;
+    if (-1 == sw_ev_setnonblock(listen_fd)
+        || -1 == sw_ev_io_add(ctx, listen_fd, SW_EV_READ, sw_ev_acceptor_ready_, acceptor))
+    {
+        sw_log_error("%s:%d can't watch listening fd %d: %d", __FILE__, __LINE__, listen_fd, SW_ERRNO);
+        sw_ev_free(acceptor);
+        return NULL;
+    }
+    return acceptor;
+}
+
+void
+sw_ev_acceptor_free(sw_ev_acceptor_t *acceptor)
+{
+    if (NULL == acceptor || acceptor->freed)
+    {
+        return;
+    }
+    if (NULL != acceptor->pause_timer)
+    {
+        sw_ev_timer_del(acceptor->ctx, acceptor->pause_timer);
+        acceptor->pause_timer = NULL;
+    }
+    else
+    {
+        sw_ev_io_del(acceptor->ctx, acceptor->listen_fd, SW_EV_READ);
+    }
+    if (acceptor->in_callback)
+    {
+        acceptor->freed = 1;
+        return;
+    }
+    sw_ev_free(acceptor);
+}
+
+int
+sw_ev_acceptor_paused(sw_ev_acceptor_t *acceptor)
+{
+    return NULL != acceptor->pause_timer;
+}
@@ -0,0 +1,75 @@
+/**
+ * Acceptor of a listening socket for libswevent.
+ * Each time the listening socket is readable it accepts up to budget connections,
+ * with accept4(SOCK_NONBLOCK | SOCK_CLOEXEC) where available so the new fds need no
+ * more fcntl calls, and passes them to the callback in one batch. When the budget is
+ * used up the rest of the backlog is left to the next loop iteration, so a connection
+ * storm can't starve other watchers. When fds run out (EMFILE, ENFILE) it stops
+ * watching the listening socket and retries after SW_EV_ACCEPTOR_PAUSE ms, instead
+ * of waking up for the same pending connection again and again.
+ */
+#ifndef INC_SW_ACCEPTOR_H
+#define INC_SW_ACCEPTOR_H
+
+#include "sw_event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+enum
+{
+    SW_EV_ACCEPTOR_BUDGET = 64,  /* default max count of connections accepted per iteration */
+    SW_EV_ACCEPTOR_PAUSE  = 100, /* ms, accepting is paused for it when fds run out */
+};
+
+typedef struct sw_ev_acceptor sw_ev_acceptor_t;
+
+/**
+ * Accepted connections callback.
+ * param:   fds - non-blocking and close-on-exec fds of new connections, the array is
+ *                reused after the callback returns.
+ *          count - count of fds, at least 1.
+ *          arg - user data pointer passed to sw_ev_acceptor_new().
+ * note:    The callback owns the fds. It may free the acceptor.
+ */
+typedef void (*sw_ev_accept_cb_t)(const int *fds, int count, void *arg);
+
+/**
+ * Create an acceptor of listen_fd and register it to ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          listen_fd - socket already bound and listening, set non-blocking here.
+ *          budget - max count of connections accepted per iteration, 0 for
+ *                   SW_EV_ACCEPTOR_BUDGET.
+ *          on_accept - callback of accepted connections.
+ *          arg - user data pointer passed to on_accept.
+ * return:  not NULL success, NULL failed.
+ * note:    You must use sw_ev_acceptor_free() to release it before freeing ctx.
+ */
+sw_ev_acceptor_t * sw_ev_acceptor_new(sw_ev_context_t *ctx, int listen_fd, int budget,
+                                      sw_ev_accept_cb_t on_accept, void *arg);
+
+/**
+ * Stop accepting and free the acceptor, listen_fd is not closed.
+ */
+void sw_ev_acceptor_free(sw_ev_acceptor_t *acceptor);
+
+/**
+ * Get whether accepting is paused because fds ran out, 1 paused, 0 not.
+ */
+int  sw_ev_acceptor_paused(sw_ev_acceptor_t *acceptor);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
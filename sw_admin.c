@@ -0,0 +1,431 @@
+#include "sw_admin.h"
+#include "sw_log.h"
+#include "sw_util.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+typedef int socklen_t;
+#define SW_EV_ADMIN_EAGAIN  WSAEWOULDBLOCK
+#define SW_EV_ADMIN_EINTR   WSAEINTR
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define SW_EV_ADMIN_EAGAIN  EAGAIN
+#define SW_EV_ADMIN_EINTR   EINTR
+#endif
+
+enum
+{
+    SW_EV_ADMIN_REQUEST_MAX = 2048,
+    SW_EV_ADMIN_TIMEOUT = 5000, /* ms, a connection must be served in it */
+};
+
+typedef struct sw_ev_admin_conn
+{
+    struct sw_ev_admin * admin;
+    int              fd;
+    sw_ev_timer_t  * timer;
+    char             request[SW_EV_ADMIN_REQUEST_MAX];
+    int              request_len;
+    char           * response;
+    size_t           response_len;
+    size_t           response_capacity;
+    size_t           sent;
+    struct sw_ev_admin_conn * prev;
+    struct sw_ev_admin_conn * next;
+} sw_ev_admin_conn_t;
+
+struct sw_ev_admin
+{
+    sw_ev_context_t    * ctx;
+    int                  listen_fd;
+    unsigned short       port;
+    sw_ev_admin_conn_t * conns;
+    sw_ev_stats_t        last_stats; /* snapshot of previous scrape, for rates */
+    int64_t              last_time;  /* us */
+};
+
+static void
+sw_ev_admin_close_(sw_ev_admin_conn_t *conn)
+{
+    sw_ev_admin_t *admin = conn->admin;
+    sw_ev_io_del(admin->ctx, conn->fd, SW_EV_READ | SW_EV_WRITE);
+    SW_EV_CLOSESOCKET(conn->fd);
+    sw_ev_timer_del(admin->ctx, conn->timer);
+    if (NULL != conn->prev)
+    {
+        conn->prev->next = conn->next;
+    }
+    else
+    {
+        admin->conns = conn->next;
+    }
+    if (NULL != conn->next)
+    {
+        conn->next->prev = conn->prev;
+    }
+    sw_ev_free(conn->response);
+    sw_ev_free(conn);
+}
+
+static void
+sw_ev_admin_timeout_(void *arg)
+{
+    sw_ev_admin_close_((sw_ev_admin_conn_t *)arg);
+}
+
+static void
+sw_ev_admin_append_(sw_ev_admin_conn_t *conn, const char *format, ...)
+{
+    va_list args;
+    int n;
+    va_start(args, format);
+    n = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (n < 0)
+    {
+        return;
+    }
+    if (conn->response_len + n + 1 > conn->response_capacity)
+    {
+        size_t capacity = conn->response_capacity ? conn->response_capacity * 2 : 4096;
+        char *response;
+        if (capacity < conn->response_len + n + 1)
+        {
+            capacity = conn->response_len + n + 1;
+        }
+        response = (char *)sw_ev_realloc(conn->response, capacity);
+        if (NULL == response)
+        {
+            return;
+        }
+        conn->response = response;
+        conn->response_capacity = capacity;
+    }
+    va_start(args, format);
+    vsnprintf(conn->response + conn->response_len,
+              conn->response_capacity - conn->response_len, format, args);
+    va_end(args);
+    conn->response_len += n;
+}
+
+static void
+sw_ev_admin_metric_(sw_ev_admin_conn_t *conn, const char *name, const char *type,
+                    const char *help, double value)
+{
+    sw_ev_admin_append_(conn, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n",
+                        name, help, name, type, name, value);
+}
+
+static void
+sw_ev_admin_metrics_(sw_ev_admin_conn_t *conn)
+{
+    sw_ev_admin_t *admin = conn->admin;
+    sw_ev_stats_t stats;
+    int64_t now = sw_ev_gettime_us();
+    double elapsed = (now - admin->last_time) / 1e6;
+    double wait;
+    sw_ev_context_stats(admin->ctx, &stats);
+    wait = (double)(stats.poll_wait_time - admin->last_stats.poll_wait_time);
+    sw_ev_admin_append_(conn, "# HELP swevent_info Backend of the event loop.\n"
+                              "# TYPE swevent_info gauge\nswevent_info{backend=\"%s\"} 1\n",
+                        sw_ev_backend_name(admin->ctx));
+    sw_ev_admin_metric_(conn, "swevent_loop_iterations_total", "counter",
+                        "Event loop iterations.", (double)stats.loop_iterations);
+    sw_ev_admin_metric_(conn, "swevent_loop_iterations_per_second", "gauge",
+                        "Event loop iteration rate since previous scrape.",
+                        elapsed > 0 ? (stats.loop_iterations - admin->last_stats.loop_iterations) / elapsed : 0);
+    sw_ev_admin_metric_(conn, "swevent_poll_calls_total", "counter",
+                        "Poll-wait calls.", (double)stats.poll_calls);
+    sw_ev_admin_metric_(conn, "swevent_poll_ready_events_total", "counter",
+                        "Ready events returned by poll-wait.", (double)stats.poll_ready_events);
+    sw_ev_admin_metric_(conn, "swevent_poll_ready_max", "gauge",
+                        "Most ready events returned by one poll-wait.", (double)stats.poll_ready_max);
+    sw_ev_admin_metric_(conn, "swevent_poll_wait_seconds_total", "counter",
+                        "Time blocked in poll-wait.", stats.poll_wait_time / 1e6);
+    sw_ev_admin_metric_(conn, "swevent_busy_seconds_total", "counter",
+                        "Time out of poll-wait, running callbacks and the loop itself.", stats.busy_time / 1e6);
+    sw_ev_admin_metric_(conn, "swevent_poll_wait_ratio", "gauge",
+                        "Share of time blocked in poll-wait since previous scrape, low means saturated.",
+                        elapsed > 0 ? wait / 1e6 / elapsed : 1);
+    sw_ev_admin_metric_(conn, "swevent_events_dispatched_total", "counter",
+                        "Io callbacks called.", (double)stats.events_dispatched);
+    sw_ev_admin_metric_(conn, "swevent_timers_fired_total", "counter",
+                        "Timer callbacks called.", (double)stats.timers_fired);
+    sw_ev_admin_metric_(conn, "swevent_timer_lateness_seconds_total", "counter",
+                        "Sum of timers' delay from expire time to fire time.", stats.timer_lateness_total / 1e3);
+    sw_ev_admin_metric_(conn, "swevent_timer_lateness_max_seconds", "gauge",
+                        "Max delay of a timer from expire time to fire time.", stats.timer_lateness_max / 1e3);
+    sw_ev_admin_metric_(conn, "swevent_io_registered", "gauge",
+                        "Fds with interested events.", (double)stats.io_registered);
+    sw_ev_admin_metric_(conn, "swevent_timers_registered", "gauge",
+                        "Registered timers.", (double)stats.timers_registered);
+    admin->last_stats = stats;
+    admin->last_time = now;
+}
+
+/*
+ * Build the whole response, the body is appended after a header with enough space
+ * reserved, then the header is written in front of it. conn->response is NULL if
+ * the header space can't be reserved.
+ */
+static void
+sw_ev_admin_respond_(sw_ev_admin_conn_t *conn)
+{
+    const char *status = "200 OK";
+    const char *content_type = "text/plain; version=0.0.4";
+    char header[256];
+    size_t body_offset = sizeof(header);
+    int header_len;
+    sw_ev_admin_append_(conn, "%*s", (int)body_offset, "");
+    if (conn->response_len < body_offset)
+    {
+        return; /* the caller closes the connection */
+    }
+    if (0 != strncmp(conn->request, "GET ", 4))
+    {
+        status = "405 Method Not Allowed";
+        sw_ev_admin_append_(conn, "method not allowed\n");
+    }
+    else if (0 == strncmp(conn->request + 4, "/metrics ", 9) || 0 == strncmp(conn->request + 4, "/metrics?", 9))
+    {
+        sw_ev_admin_metrics_(conn);
+    }
+    else if (0 == strncmp(conn->request + 4, "/watchers ", 10))
+    {
+        int len = sw_ev_context_dump(conn->admin->ctx, NULL, 0, SW_EV_DUMP_JSON);
+        char *response = (char *)sw_ev_realloc(conn->response, body_offset + len + 1);
+        content_type = "application/json";
+        if (NULL != response)
+        {
+            conn->response = response;
+            conn->response_capacity = body_offset + len + 1;
+            sw_ev_context_dump(conn->admin->ctx, conn->response + body_offset, len + 1, SW_EV_DUMP_JSON);
+            conn->response_len = body_offset + len;
+        }
+    }
+    else
+    {
+        status = "404 Not Found";
+        sw_ev_admin_append_(conn, "not found, try /metrics or /watchers\n");
+    }
+    if (NULL == conn->response)
+    {
+        return;
+    }
+    header_len = snprintf(header, sizeof(header),
+                          "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                          "Connection: close\r\n\r\n",
+                          status, content_type, (unsigned)(conn->response_len - body_offset));
+    conn->sent = body_offset - header_len;
+    memcpy(conn->response + conn->sent, header, header_len);
+}
+
+/*
+ * Send the rest of response, return 1 if all sent, 0 if blocked, -1 if failed.
+ */
+static int
+sw_ev_admin_send_(sw_ev_admin_conn_t *conn)
+{
+    int ret;
+    while (conn->sent < conn->response_len)
+    {
+        ret = send(conn->fd, conn->response + conn->sent, (int)(conn->response_len - conn->sent), 0);
+        if (ret > 0)
+        {
+            conn->sent += ret;
+        }
+        else if (ret < 0 && SW_ERRNO == SW_EV_ADMIN_EINTR)
+        {
+            continue;
+        }
+        else if (ret < 0 && SW_ERRNO == SW_EV_ADMIN_EAGAIN)
+        {
+            return 0;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static void
+sw_ev_admin_conn_ready_(int fd, int events, void *arg)
+{
+    sw_ev_admin_conn_t *conn = (sw_ev_admin_conn_t *)arg;
+    int ret;
+    if (NULL != conn->response) /* responding */
+    {
+        if (0 != sw_ev_admin_send_(conn))
+        {
+            sw_ev_admin_close_(conn);
+        }
+        return;
+    }
+    while (1)
+    {
+        ret = recv(fd, conn->request + conn->request_len,
+                   SW_EV_ADMIN_REQUEST_MAX - 1 - conn->request_len, 0);
+        if (ret > 0)
+        {
+            conn->request_len += ret;
+            conn->request[conn->request_len] = '\0';
+            if (NULL != strstr(conn->request, "\r\n\r\n") || NULL != strstr(conn->request, "\n\n"))
+            {
+                break;
+            }
+            if (conn->request_len == SW_EV_ADMIN_REQUEST_MAX - 1)
+            {
+                sw_ev_admin_close_(conn); /* request too large */
+                return;
+            }
+            continue;
+        }
+        else if (ret < 0 && SW_ERRNO == SW_EV_ADMIN_EINTR)
+        {
+            continue;
+        }
+        else if (ret < 0 && SW_ERRNO == SW_EV_ADMIN_EAGAIN)
+        {
+            return;
+        }
+        sw_ev_admin_close_(conn);
+        return;
+    }
+    sw_ev_admin_respond_(conn);
+    ret = NULL != conn->response ? sw_ev_admin_send_(conn) : -1;
+    if (0 == ret)
+    {
+        /* the request is complete, later input would keep a level triggered backend busy */
+        sw_ev_io_del(conn->admin->ctx, fd, SW_EV_READ);
+        if (0 == sw_ev_io_add(conn->admin->ctx, fd, SW_EV_WRITE, sw_ev_admin_conn_ready_, conn))
+        {
+            return;
+        }
+    }
+    sw_ev_admin_close_(conn);
+}
+
+static void
+sw_ev_admin_accept_(int fd, int events, void *arg)
+{
+    sw_ev_admin_t *admin = (sw_ev_admin_t *)arg;
+    sw_ev_admin_conn_t *conn;
+    int client;
+    while (1)
+    {
+        client = (int)accept(fd, NULL, NULL);
+        if (-1 == client)
+        {
+            if (SW_ERRNO == SW_EV_ADMIN_EINTR)
+            {
+                continue;
+            }
+            if (SW_ERRNO != SW_EV_ADMIN_EAGAIN)
+            {
+                sw_log_error("%s:%d accept: %d", __FILE__, __LINE__, SW_ERRNO);
+            }
+            return;
+        }
+        conn = (sw_ev_admin_conn_t *)sw_ev_malloc(sizeof(sw_ev_admin_conn_t));
+        if (NULL == conn)
+        {
+            sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+            SW_EV_CLOSESOCKET(client);
+            continue;
+        }
+        memset(conn, 0, sizeof(sw_ev_admin_conn_t));
+        conn->admin = admin;
+        conn->fd = client;
+        conn->timer = sw_ev_timer_add(admin->ctx, SW_EV_ADMIN_TIMEOUT, sw_ev_admin_timeout_, conn);
+        if (NULL == conn->timer
+            || -1 == sw_ev_setnonblock(client)
+            || -1 == sw_ev_io_add(admin->ctx, client, SW_EV_READ, sw_ev_admin_conn_ready_, conn))
+        {
+            sw_log_error("%s:%d can't register admin connection", __FILE__, __LINE__);
+            sw_ev_timer_del(admin->ctx, conn->timer);
+            SW_EV_CLOSESOCKET(client);
+            sw_ev_free(conn);
+            continue;
+        }
+        conn->next = admin->conns;
+        if (NULL != admin->conns)
+        {
+            admin->conns->prev = conn;
+        }
+        admin->conns = conn;
+    }
+}
+
+sw_ev_admin_t *
+sw_ev_admin_new(sw_ev_context_t *ctx, const char *ip, unsigned short port)
+{
+    sw_ev_admin_t *admin;
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int reuse = 1;
+    admin = (sw_ev_admin_t *)sw_ev_malloc(sizeof(sw_ev_admin_t));
+    if (NULL == admin)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(admin, 0, sizeof(sw_ev_admin_t));
+    admin->ctx = ctx;
+    admin->listen_fd = (int)socket(AF_INET, SOCK_STREAM, 0);
+    if (-1 == admin->listen_fd)
+    {
+        sw_log_error("%s:%d socket: %d", __FILE__, __LINE__, SW_ERRNO);
+        sw_ev_free(admin);
+        return NULL;
+    }
+    setsockopt(admin->listen_fd, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(ip);
+    addr.sin_port = htons(port);
+    if (-1 == bind(admin->listen_fd, (struct sockaddr *)&addr, sizeof(addr))
+        || -1 == listen(admin->listen_fd, 16)
+        || -1 == getsockname(admin->listen_fd, (struct sockaddr *)&addr, &addr_len)
+        || -1 == sw_ev_setnonblock(admin->listen_fd)
+        || -1 == sw_ev_io_add(ctx, admin->listen_fd, SW_EV_READ, sw_ev_admin_accept_, admin))
+    {
+        sw_log_error("%s:%d can't listen on %s:%u: %d", __FILE__, __LINE__, ip, port, SW_ERRNO);
+        SW_EV_CLOSESOCKET(admin->listen_fd);
+        sw_ev_free(admin);
+        return NULL;
+    }
+    admin->port = ntohs(addr.sin_port);
+    sw_ev_context_stats(ctx, &admin->last_stats);
+    admin->last_time = sw_ev_gettime_us();
+    return admin;
+}
+
+void
+sw_ev_admin_free(sw_ev_admin_t *admin)
+{
+    if (NULL != admin)
+    {
+        while (NULL != admin->conns)
+        {
+            sw_ev_admin_close_(admin->conns);
+        }
+        sw_ev_io_del(admin->ctx, admin->listen_fd, SW_EV_READ);
+        SW_EV_CLOSESOCKET(admin->listen_fd);
+        sw_ev_free(admin);
+    }
+}
+
+unsigned short
+sw_ev_admin_port(sw_ev_admin_t *admin)
+{
+    return admin->port;
+}
@@ -0,0 +1,53 @@
+/**
+ * Admin endpoint for libswevent.
+ * It listens on a local port with the sw_ev_context it reports, no extra thread,
+ * and answers minimal HTTP GET requests:
+ *   /metrics   loop stats of the context in Prometheus text format.
+ *   /watchers  registered watchers of the context in JSON, see sw_ev_context_dump().
+ * Each connection serves one request then is closed.
+ */
+#ifndef INC_SW_ADMIN_H
+#define INC_SW_ADMIN_H
+
+#include "sw_event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+typedef struct sw_ev_admin sw_ev_admin_t;
+
+/**
+ * Create an admin endpoint listening on ip:port and register it to ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          ip - IPv4 address to bind, should be "127.0.0.1" unless scrapers are remote.
+ *          port - port to bind, 0 for a random port, get it by sw_ev_admin_port().
+ * return:  not NULL success, NULL failed.
+ * note:    You must use sw_ev_admin_free() to release it before freeing ctx.
+ */
+sw_ev_admin_t * sw_ev_admin_new(sw_ev_context_t *ctx, const char *ip, unsigned short port);
+
+/**
+ * Close the listening socket and all connections, then free the admin endpoint.
+ */
+void sw_ev_admin_free(sw_ev_admin_t *admin);
+
+/**
+ * Get the bound port of the admin endpoint.
+ */
+unsigned short sw_ev_admin_port(sw_ev_admin_t *admin);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
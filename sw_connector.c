@@ -0,0 +1,364 @@
+#include "sw_connector.h"
+#include "sw_log.h"
+#include "sw_util.h"
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define SW_EV_CONNECT_IN_PROGRESS(err)  ((err) == WSAEWOULDBLOCK || (err) == WSAEINPROGRESS)
+#define SW_EV_CONNECT_ETIMEDOUT         WSAETIMEDOUT
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#define SW_EV_CONNECT_IN_PROGRESS(err)  ((err) == EINPROGRESS || (err) == EINTR)
+#define SW_EV_CONNECT_ETIMEDOUT         ETIMEDOUT
+#endif
+
+typedef struct sw_ev_connect_attempt
+{
+    struct sockaddr_storage addr;
+    int                     addr_len;
+    int                     fd; /* -1 when not started or finished */
+} sw_ev_connect_attempt_t;
+
+struct sw_ev_connector
+{
+    sw_ev_context_t         * ctx;
+    sw_ev_connect_cb_t        on_connect;
+    void                    * arg;
+    sw_ev_timer_t           * deadline;
+    sw_ev_timer_t           * delay;    /* starts the next attempt */
+    int                       count;
+    int                       next;     /* index of the next attempt to start */
+    int                       pending;  /* count of attempts in flight */
+    int                       last_error;
+    sw_ev_connect_attempt_t   attempts[SW_EV_CONNECT_MAX_CANDIDATES];
+};
+
+static void sw_ev_connect_ready_(int fd, int events, void *arg);
+static void sw_ev_connect_delay_(void *arg);
+
+static int
+sw_ev_connect_socket_(int family)
+{
+    int fd;
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+    fd = (int)socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+#else
+    fd = (int)socket(family, SOCK_STREAM, 0);
+    if (-1 != fd)
+    {
+        sw_ev_setnonblock(fd);
+#ifndef _WIN32
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    }
+#endif
+    return fd;
+}
+
+/*
+ * Close attempts in flight except the winner, then free the connector.
+ */
+static void
+sw_ev_connect_release_(sw_ev_connector_t *connector, int keep_fd)
+{
+    int i;
+    for (i = 0; i < connector->next; ++i)
+    {
+        int fd = connector->attempts[i].fd;
+        if (-1 != fd)
+        {
+            sw_ev_io_del(connector->ctx, fd, SW_EV_WRITE);
+            if (fd != keep_fd)
+            {
+                SW_EV_CLOSESOCKET(fd);
+            }
+        }
+    }
+    if (NULL != connector->deadline)
+    {
+        sw_ev_timer_del(connector->ctx, connector->deadline);
+    }
+    if (NULL != connector->delay)
+    {
+        sw_ev_timer_del(connector->ctx, connector->delay);
+    }
+    sw_ev_free(connector);
+}
+
+static void
+sw_ev_connect_finish_(sw_ev_connector_t *connector, int fd, int error)
+{
+    sw_ev_connect_cb_t on_connect = connector->on_connect;
+    void *arg = connector->arg;
+    sw_ev_connect_release_(connector, fd);
+    on_connect(fd, error, arg);
+}
+
+/*
+ * Start attempts in order until one is in flight or none is left.
+ * return:  0 an attempt started, -1 no more candidates.
+ */
+static int
+sw_ev_connect_start_next_(sw_ev_connector_t *connector)
+{
+    sw_ev_connect_attempt_t *attempt;
+    int err;
+    while (connector->next < connector->count)
+    {
+        attempt = &connector->attempts[connector->next++];
+        attempt->fd = sw_ev_connect_socket_(attempt->addr.ss_family);
+        if (-1 == attempt->fd)
+        {
+            connector->last_error = SW_ERRNO;
+            continue;
+        }
+        if (0 != connect(attempt->fd, (struct sockaddr *)&attempt->addr, attempt->addr_len))
+        {
+            err = SW_ERRNO;
+            if (!SW_EV_CONNECT_IN_PROGRESS(err))
+            {
+                connector->last_error = err;
+                SW_EV_CLOSESOCKET(attempt->fd);
+                attempt->fd = -1;
+                continue;
+            }
+        }
+        /* connected at once is reported by the write event too */
+        if (-1 == sw_ev_io_add(connector->ctx, attempt->fd, SW_EV_WRITE, sw_ev_connect_ready_, connector))
+        {
+            connector->last_error = SW_ERRNO;
+            SW_EV_CLOSESOCKET(attempt->fd);
+            attempt->fd = -1;
+            continue;
+        }
+        ++connector->pending;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+ * Start the next attempt and restart the attempt delay from now.
+ */
+static void
+sw_ev_connect_advance_(sw_ev_connector_t *connector)
+{
+    if (NULL != connector->delay)
+    {
+        sw_ev_timer_del(connector->ctx, connector->delay);
+        connector->delay = NULL;
+    }
+    if (0 == sw_ev_connect_start_next_(connector) && connector->next < connector->count)
+    {
+        connector->delay = sw_ev_timer_add(connector->ctx, SW_EV_CONNECT_ATTEMPT_DELAY,
+                                           sw_ev_connect_delay_, connector);
+    }
+}
+
+static void
+sw_ev_connect_delay_(void *arg)
+{
+    sw_ev_connect_advance_((sw_ev_connector_t *)arg);
+}
+
+static void
+sw_ev_connect_timeout_(void *arg)
+{
+    sw_ev_connector_t *connector = (sw_ev_connector_t *)arg;
+    sw_ev_timer_del(connector->ctx, connector->deadline);
+    connector->deadline = NULL;
+    sw_ev_connect_finish_(connector, -1, SW_EV_CONNECT_ETIMEDOUT);
+}
+
+static void
+sw_ev_connect_ready_(int fd, int events, void *arg)
+{
+    sw_ev_connector_t *connector = (sw_ev_connector_t *)arg;
+    int error = 0;
+    socklen_t len = sizeof(error);
+    int i;
+    if (-1 == getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *)&error, &len))
+    {
+        error = SW_ERRNO;
+    }
+    if (0 == error)
+    {
+        sw_ev_connect_finish_(connector, fd, 0);
+        return;
+    }
+    for (i = 0; i < connector->next; ++i)
+    {
+        if (connector->attempts[i].fd == fd)
+        {
+            connector->attempts[i].fd = -1;
+            break;
+        }
+    }
+    sw_ev_io_del(connector->ctx, fd, SW_EV_WRITE);
+    SW_EV_CLOSESOCKET(fd);
+    --connector->pending;
+    connector->last_error = error;
+    /* a failed attempt starts the next one without waiting for the delay */
+    sw_ev_connect_advance_(connector);
+    if (0 == connector->pending)
+    {
+        sw_ev_connect_finish_(connector, -1, connector->last_error);
+    }
+}
+
+static const struct addrinfo *
+sw_ev_connect_next_of_(const struct addrinfo *ai, int family, int same)
+{
+    for (; NULL != ai; ai = ai->ai_next)
+    {
+        if ((ai->ai_family == family) == same)
+        {
+            return ai;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Append candidates interleaving address families, starting with the family of the
+ * first candidate, RFC 8305 section 4.
+ */
+static void
+sw_ev_connect_order_(sw_ev_connector_t *connector, const struct addrinfo *candidates)
+{
+    const struct addrinfo *cursors[2]; /* the first family, the other families */
+    const struct addrinfo *ai;
+    int first_family;
+    int turn = 0;
+    if (NULL == candidates)
+    {
+        return;
+    }
+    first_family = candidates->ai_family;
+    cursors[0] = candidates;
+    cursors[1] = sw_ev_connect_next_of_(candidates, first_family, 0);
+    while (connector->count < SW_EV_CONNECT_MAX_CANDIDATES
+           && (NULL != cursors[0] || NULL != cursors[1]))
+    {
+        ai = cursors[turn];
+        if (NULL != ai)
+        {
+            if ((AF_INET == ai->ai_family || AF_INET6 == ai->ai_family)
+                && (0 == ai->ai_socktype || SOCK_STREAM == ai->ai_socktype)
+                && ai->ai_addrlen <= sizeof(struct sockaddr_storage))
+            {
+                sw_ev_connect_attempt_t *attempt = &connector->attempts[connector->count++];
+                memcpy(&attempt->addr, ai->ai_addr, ai->ai_addrlen);
+                attempt->addr_len = (int)ai->ai_addrlen;
+                attempt->fd = -1;
+            }
+            cursors[turn] = sw_ev_connect_next_of_(ai->ai_next, first_family, 0 == turn);
+        }
+        turn = !turn;
+    }
+}
+
+static sw_ev_connector_t *
+sw_ev_connect_start_(sw_ev_connector_t *connector, int timeout_ms)
+{
+    if (0 == connector->count)
+    {
+        sw_log_error("%s:%d no TCP candidate address", __FILE__, __LINE__);
+        sw_ev_free(connector);
+        return NULL;
+    }
+    if (-1 == sw_ev_connect_start_next_(connector))
+    {
+        sw_log_error("%s:%d connect: %d", __FILE__, __LINE__, connector->last_error);
+        sw_ev_connect_release_(connector, -1);
+        return NULL;
+    }
+    if (timeout_ms > 0)
+    {
+        connector->deadline = sw_ev_timer_add(connector->ctx, timeout_ms, sw_ev_connect_timeout_, connector);
+    }
+    if (connector->next < connector->count)
+    {
+        connector->delay = sw_ev_timer_add(connector->ctx, SW_EV_CONNECT_ATTEMPT_DELAY,
+                                           sw_ev_connect_delay_, connector);
+    }
+    if ((timeout_ms > 0 && NULL == connector->deadline)
+        || (connector->next < connector->count && NULL == connector->delay))
+    {
+        sw_log_error("%s:%d sw_ev_timer_add failed", __FILE__, __LINE__);
+        sw_ev_connect_release_(connector, -1);
+        return NULL;
+    }
+    return connector;
+}
+
+static sw_ev_connector_t *
+sw_ev_connect_new_(sw_ev_context_t *ctx, sw_ev_connect_cb_t on_connect, void *arg)
+{
+    sw_ev_connector_t *connector;
+    if (NULL == ctx || NULL == on_connect)
+    {
+        return NULL;
+    }
+    connector = (sw_ev_connector_t *)sw_ev_malloc(sizeof(sw_ev_connector_t));
+    if (NULL == connector)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(connector, 0, sizeof(sw_ev_connector_t));
+    connector->ctx = ctx;
+    connector->on_connect = on_connect;
+    connector->arg = arg;
+    return connector;
+}
+
+sw_ev_connector_t *
+sw_ev_connect(sw_ev_context_t *ctx, const struct addrinfo *candidates,
+              int timeout_ms, sw_ev_connect_cb_t on_connect, void *arg)
+{
+    sw_ev_connector_t *connector = sw_ev_connect_new_(ctx, on_connect, arg);
+    if (NULL == connector)
+    {
+        return NULL;
+    }
+    sw_ev_connect_order_(connector, candidates);
+    return sw_ev_connect_start_(connector, timeout_ms);
+}
+
+sw_ev_connector_t *
+sw_ev_connect_addr(sw_ev_context_t *ctx, const struct sockaddr *addr,
+                   int addr_len, int timeout_ms,
+                   sw_ev_connect_cb_t on_connect, void *arg)
+{
+    sw_ev_connector_t *connector;
+    if (NULL == addr || addr_len <= 0 || addr_len > (int)sizeof(struct sockaddr_storage))
+    {
+        return NULL;
+    }
+    connector = sw_ev_connect_new_(ctx, on_connect, arg);
+    if (NULL == connector)
+    {
+        return NULL;
+    }
+    memcpy(&connector->attempts[0].addr, addr, addr_len);
+    connector->attempts[0].addr_len = addr_len;
+    connector->attempts[0].fd = -1;
+    connector->count = 1;
+    return sw_ev_connect_start_(connector, timeout_ms);
+}
+
+void
+sw_ev_connect_cancel(sw_ev_connector_t *connector)
+{
+    if (NULL != connector)
+    {
+        sw_ev_connect_release_(connector, -1);
+    }
+}
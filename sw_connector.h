@@ -0,0 +1,79 @@
+/**
+ * Non-blocking TCP connector for libswevent.
+ * It connects to one of the candidate addresses without blocking the loop, and calls
+ * back with the connected socket or the error. Candidates are tried the happy eyeballs
+ * way (RFC 8305): address families are interleaved, a new attempt starts every
+ * SW_EV_CONNECT_ATTEMPT_DELAY ms or as soon as the previous one fails, attempts in
+ * flight race and the first connected one wins. Name resolution is not done here,
+ * pass the result of getaddrinfo() resolved elsewhere, or numeric addresses.
+ */
+#ifndef INC_SW_CONNECTOR_H
+#define INC_SW_CONNECTOR_H
+
+#include "sw_event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+struct sockaddr;
+struct addrinfo;
+
+enum
+{
+    SW_EV_CONNECT_ATTEMPT_DELAY = 250, /* ms, RFC 8305 recommended connection attempt delay */
+    SW_EV_CONNECT_MAX_CANDIDATES = 16, /* more candidates are ignored */
+};
+
+typedef struct sw_ev_connector sw_ev_connector_t;
+
+/**
+ * Connect result callback.
+ * param:   fd - connected non-blocking socket owned by the callback, -1 if failed.
+ *          error - 0 success, else the error (SW_ERRNO value) of the last failed
+ *                  attempt, ETIMEDOUT if the deadline expired.
+ *          arg - user data pointer passed to sw_ev_connect().
+ * note:    The connector is freed after the callback returns.
+ */
+typedef void (*sw_ev_connect_cb_t)(int fd, int error, void *arg);
+
+/**
+ * Start connecting to the candidate addresses.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          candidates - addresses list, e.g. from getaddrinfo(), only read in this call.
+ *          timeout_ms - deadline of the whole connect, 0 for no deadline.
+ *          on_connect - result callback, called once from the loop.
+ *          arg - user data pointer passed to on_connect.
+ * return:  not NULL success, NULL failed without calling back, e.g. no attempt could
+ *          be started, SW_ERRNO tells why.
+ */
+sw_ev_connector_t * sw_ev_connect(sw_ev_context_t *ctx, const struct addrinfo *candidates,
+                                  int timeout_ms, sw_ev_connect_cb_t on_connect, void *arg);
+
+/**
+ * Start connecting to one address, see sw_ev_connect().
+ */
+sw_ev_connector_t * sw_ev_connect_addr(sw_ev_context_t *ctx, const struct sockaddr *addr,
+                                       int addr_len, int timeout_ms,
+                                       sw_ev_connect_cb_t on_connect, void *arg);
+
+/**
+ * Abort a connect in progress without calling back, and free the connector.
+ * note:    Don't call it in or after the callback, the connector is already freed.
+ */
+void sw_ev_connect_cancel(sw_ev_connector_t *connector);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,478 @@
+/**
+ * C++20 coroutines on libswevent, header only.
+ * A sw::task<T> is a lazy coroutine, it runs when awaited by another task or started
+ * by sw::spawn(). Awaitables suspend on sw_ev_io_add()/sw_ev_timer_add() and the
+ * coroutine is resumed inline by the callback called from sw_ev_loop():
+ *
+ *     sw::task<> echo(sw_ev_context_t *ctx, int fd)
+ *     {
+ *         char buf[4096];
+ *         ssize_t n;
+ *         while ((n = co_await sw::recv(ctx, fd, buf, sizeof(buf))) > 0)
+ *         {
+ *             if (co_await sw::send_all(ctx, fd, buf, n) < 0) break;
+ *         }
+ *         close(fd);
+ *     }
+ *     sw::spawn(echo(ctx, fd));
+ *
+ * Coroutine frames are allocated from per-thread pools of size classes, freed frames
+ * are kept for reuse, so a million concurrent sessions cost their frames only.
+ * Like sw_ev_io_add(), one fd has one callback, so at most one coroutine may wait
+ * on a fd at a time. A waiting awaitable unregisters itself when the suspended task
+ * is destroyed. Sockets must be non-blocking.
+ */
+#ifndef INC_SW_CORO_HPP
+#define INC_SW_CORO_HPP
+
+#include "sw_event.h"
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <utility>
+#include <cerrno>
+#include <cstddef>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif
+
+namespace sw
+{
+
+namespace detail
+{
+
+/*
+ * Free lists of frames by size class, frames larger than the biggest class use
+ * the global operator new.
+ */
+class frame_pool
+{
+public:
+    enum { granularity = 64, classes = 64 }; /* pooled up to 4KB */
+
+    static frame_pool & local()
+    {
+        thread_local frame_pool pool;
+        return pool;
+    }
+
+    void * allocate(std::size_t size)
+    {
+        std::size_t index = (size + granularity - 1) / granularity;
+        if (index >= classes)
+        {
+            return ::operator new(size);
+        }
+        if (nullptr != free_[index])
+        {
+            node *frame = free_[index];
+            free_[index] = frame->next;
+            return frame;
+        }
+        return ::operator new(index * granularity);
+    }
+
+    void deallocate(void *p, std::size_t size)
+    {
+        std::size_t index = (size + granularity - 1) / granularity;
+        if (index >= classes)
+        {
+            ::operator delete(p);
+            return;
+        }
+        node *frame = static_cast<node *>(p);
+        frame->next = free_[index];
+        free_[index] = frame;
+    }
+
+    ~frame_pool()
+    {
+        for (std::size_t i = 0; i < classes; ++i)
+        {
+            while (nullptr != free_[i])
+            {
+                node *frame = free_[i];
+                free_[i] = frame->next;
+                ::operator delete(frame);
+            }
+        }
+    }
+
+private:
+    struct node { node *next; };
+    node * free_[classes] = {};
+};
+
+struct promise_base
+{
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr      exception_;
+    bool                    detached_ = false;
+
+    static void * operator new(std::size_t size) { return frame_pool::local().allocate(size); }
+    static void operator delete(void *p, std::size_t size) { frame_pool::local().deallocate(p, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    /* resume the awaiting task, or free the frame of a spawned one */
+    struct final_awaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            promise_base &promise = h.promise();
+            if (promise.detached_)
+            {
+                if (promise.exception_)
+                {
+                    std::terminate(); /* nobody can receive it */
+                }
+                h.destroy();
+                return std::noop_coroutine();
+            }
+            if (promise.continuation_)
+            {
+                return promise.continuation_;
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception_ = std::current_exception(); }
+};
+
+template <class T>
+struct promise : promise_base
+{
+    T value_;
+    template <class U>
+    void return_value(U &&value) { value_ = std::forward<U>(value); }
+    T result()
+    {
+        if (exception_) std::rethrow_exception(exception_);
+        return std::move(value_);
+    }
+};
+
+template <>
+struct promise<void> : promise_base
+{
+    void return_void() {}
+    void result()
+    {
+        if (exception_) std::rethrow_exception(exception_);
+    }
+};
+
+} /* namespace detail */
+
+/**
+ * Lazy coroutine returning T, owned by the task object until it's awaited or spawned.
+ */
+template <class T = void>
+class task
+{
+public:
+    struct promise_type : detail::promise<T>
+    {
+        task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    };
+
+    task(task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    task & operator=(task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    task(const task &) = delete;
+    task & operator=(const task &) = delete;
+    ~task() { if (handle_) handle_.destroy(); }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation_ = awaiting;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().result(); }
+
+    /* give up the ownership, used by sw::spawn() */
+    std::coroutine_handle<promise_type> release() { return std::exchange(handle_, nullptr); }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * Start a task without awaiting it, its frame is freed when it completes.
+ * note:    An exception escaping a spawned task calls std::terminate().
+ */
+inline void spawn(task<> t)
+{
+    std::coroutine_handle<task<>::promise_type> handle = t.release();
+    if (handle)
+    {
+        handle.promise().detached_ = true;
+        handle.resume();
+    }
+}
+
+/**
+ * co_await sw::readable(ctx, fd) / sw::writable(ctx, fd), resumes when the events are
+ * ready and returns the ready events (SW_EV_*), or -1 if registering failed.
+ */
+class io_awaiter
+{
+public:
+    io_awaiter(sw_ev_context_t *ctx, int fd, int events) : ctx_(ctx), fd_(fd), events_(events) {}
+    io_awaiter(const io_awaiter &) = delete;
+    ~io_awaiter() { if (pending_) sw_ev_io_del(ctx_, fd_, events_); }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        if (-1 == sw_ev_io_add(ctx_, fd_, events_, &io_awaiter::thunk, this))
+        {
+            ready_ = -1;
+            return false;
+        }
+        pending_ = true;
+        return true;
+    }
+    int await_resume() const noexcept { return ready_; }
+
+private:
+    static void thunk(int fd, int events, void *arg)
+    {
+        io_awaiter *self = static_cast<io_awaiter *>(arg);
+        sw_ev_io_del(self->ctx_, fd, self->events_);
+        self->pending_ = false;
+        self->ready_ = events;
+        self->handle_.resume();
+    }
+
+    sw_ev_context_t *       ctx_;
+    int                     fd_;
+    int                     events_;
+    int                     ready_ = 0;
+    bool                    pending_ = false;
+    std::coroutine_handle<> handle_;
+};
+
+inline io_awaiter readable(sw_ev_context_t *ctx, int fd) { return io_awaiter(ctx, fd, SW_EV_READ); }
+inline io_awaiter writable(sw_ev_context_t *ctx, int fd) { return io_awaiter(ctx, fd, SW_EV_WRITE); }
+
+/**
+ * co_await sw::sleep_for(ctx, ms), resumes after ms expired, returns 0, or -1 if adding
+ * the timer failed.
+ */
+class sleep_awaiter
+{
+public:
+    sleep_awaiter(sw_ev_context_t *ctx, int timeout_ms) : ctx_(ctx), timeout_(timeout_ms) {}
+    sleep_awaiter(const sleep_awaiter &) = delete;
+    ~sleep_awaiter() { if (nullptr != timer_) sw_ev_timer_del(ctx_, timer_); }
+
+    bool await_ready() const noexcept { return timeout_ <= 0; }
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        timer_ = sw_ev_timer_add(ctx_, timeout_, &sleep_awaiter::thunk, this);
+        if (nullptr == timer_)
+        {
+            result_ = -1;
+            return false;
+        }
+        return true;
+    }
+    int await_resume() const noexcept { return result_; }
+
+private:
+    static void thunk(void *arg)
+    {
+        sleep_awaiter *self = static_cast<sleep_awaiter *>(arg);
+        sw_ev_timer_del(self->ctx_, self->timer_);
+        self->timer_ = nullptr;
+        self->handle_.resume();
+    }
+
+    sw_ev_context_t *       ctx_;
+    int                     timeout_;
+    int                     result_ = 0;
+    sw_ev_timer_t *         timer_ = nullptr;
+    std::coroutine_handle<> handle_;
+};
+
+inline sleep_awaiter sleep_for(sw_ev_context_t *ctx, int timeout_ms) { return sleep_awaiter(ctx, timeout_ms); }
+
+namespace detail
+{
+
+inline bool would_block()
+{
+#ifdef _WIN32
+    return WSAEWOULDBLOCK == WSAGetLastError();
+#else
+    return EAGAIN == errno || EWOULDBLOCK == errno;
+#endif
+}
+
+inline bool interrupted()
+{
+#ifdef _WIN32
+    return WSAEINTR == WSAGetLastError();
+#else
+    return EINTR == errno;
+#endif
+}
+
+/*
+ * Try Op first, wait events of fd and retry only when it would block, so a ready
+ * socket costs no registration. The retry is done in the io callback, the coroutine
+ * is resumed once with the result.
+ */
+template <class Op>
+class io_op_awaiter
+{
+public:
+    io_op_awaiter(sw_ev_context_t *ctx, int fd, int events, const Op &op)
+        : ctx_(ctx), fd_(fd), events_(events), op_(op) {}
+    io_op_awaiter(const io_op_awaiter &) = delete;
+    ~io_op_awaiter() { if (pending_) sw_ev_io_del(ctx_, fd_, events_); }
+
+    bool await_ready() { return attempt(); }
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        if (-1 == sw_ev_io_add(ctx_, fd_, events_, &io_op_awaiter::thunk, this))
+        {
+            result_ = -1;
+            return false;
+        }
+        pending_ = true;
+        return true;
+    }
+    long await_resume() const noexcept { return result_; }
+
+private:
+    bool attempt()
+    {
+        while (true)
+        {
+            result_ = op_(fd_);
+            if (result_ >= 0 || !interrupted())
+            {
+                return result_ >= 0 || !would_block();
+            }
+        }
+    }
+
+    static void thunk(int fd, int events, void *arg)
+    {
+        io_op_awaiter *self = static_cast<io_op_awaiter *>(arg);
+        if (self->attempt())
+        {
+            sw_ev_io_del(self->ctx_, fd, self->events_);
+            self->pending_ = false;
+            self->handle_.resume();
+        }
+    }
+
+    sw_ev_context_t *       ctx_;
+    int                     fd_;
+    int                     events_;
+    Op                      op_;
+    long                    result_ = 0;
+    bool                    pending_ = false;
+    std::coroutine_handle<> handle_;
+};
+
+struct recv_op
+{
+    void *      buf;
+    std::size_t len;
+    long operator()(int fd) const { return (long)::recv(fd, (char *)buf, (int)len, 0); }
+};
+
+struct send_op
+{
+    const void * buf;
+    std::size_t  len;
+    long operator()(int fd) const
+    {
+#ifdef MSG_NOSIGNAL
+        return (long)::send(fd, (const char *)buf, len, MSG_NOSIGNAL);
+#else
+        return (long)::send(fd, (const char *)buf, (int)len, 0);
+#endif
+    }
+};
+
+struct accept_op
+{
+    long operator()(int fd) const { return (long)::accept(fd, nullptr, nullptr); }
+};
+
+} /* namespace detail */
+
+/**
+ * co_await sw::recv(ctx, fd, buf, len), returns the same as recv(), 0 when the peer
+ * closed, -1 on error with errno set.
+ */
+inline detail::io_op_awaiter<detail::recv_op> recv(sw_ev_context_t *ctx, int fd, void *buf, std::size_t len)
+{
+    return detail::io_op_awaiter<detail::recv_op>(ctx, fd, SW_EV_READ, detail::recv_op{buf, len});
+}
+
+/**
+ * co_await sw::send(ctx, fd, buf, len), returns count of sent bytes, maybe less than len,
+ * or -1 on error with errno set.
+ */
+inline detail::io_op_awaiter<detail::send_op> send(sw_ev_context_t *ctx, int fd, const void *buf, std::size_t len)
+{
+    return detail::io_op_awaiter<detail::send_op>(ctx, fd, SW_EV_WRITE, detail::send_op{buf, len});
+}
+
+/**
+ * co_await sw::accept(ctx, listen_fd), returns the accepted socket (blocking mode, make
+ * it non-blocking by sw_ev_setnonblock()), or -1 on error with errno set.
+ */
+inline detail::io_op_awaiter<detail::accept_op> accept(sw_ev_context_t *ctx, int listen_fd)
+{
+    return detail::io_op_awaiter<detail::accept_op>(ctx, listen_fd, SW_EV_READ, detail::accept_op{});
+}
+
+/**
+ * Send all len bytes, returns len, or -1 on error with errno set.
+ */
+inline task<long> send_all(sw_ev_context_t *ctx, int fd, const void *buf, std::size_t len)
+{
+    std::size_t sent = 0;
+    while (sent < len)
+    {
+        long n = co_await send(ctx, fd, (const char *)buf + sent, len - sent);
+        if (n < 0)
+        {
+            co_return -1;
+        }
+        sent += n;
+    }
+    co_return (long)len;
+}
+
+} /* namespace sw */
+
+#endif
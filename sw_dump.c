@@ -0,0 +1,223 @@
+#include "sw_event_internal.h"
+#include "sw_timer_heap.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+int
+sw_ev_watcher_foreach(sw_ev_context_t *ctx,
+                      int (*fn)(const sw_ev_watcher_info_t *info, void *arg),
+                      void *arg)
+{
+    sw_ev_watcher_info_t info;
+    int count = 0;
+    int i;
+    unsigned index;
+    sw_ev_timer_group_t *group;
+    sw_ev_batch_timer_t *member;
+    memset(&info, 0, sizeof(info));
+    info.kind = SW_EV_WATCHER_IO;
+    for (i = 0; i < ctx->io_events_count; ++i)
+    {
+        if (ctx->io_events[i].events)
+        {
+            info.fd = i;
+            info.events = ctx->io_events[i].events;
+            info.callback = (void *)ctx->io_events[i].callback;
+            info.arg = ctx->io_events[i].arg;
+            ++count;
+            if (fn(&info, arg))
+            {
+                return count;
+            }
+        }
+    }
+    memset(&info, 0, sizeof(info));
+    info.kind = SW_EV_WATCHER_TIMER;
+    info.fd = -1;
+    for (index = 0; index < sw_timer_heap_size(ctx->timer_heap); ++index)
+    {
+        sw_ev_timer_t *timer = sw_timer_heap_at(ctx->timer_heap, index);
+        info.callback = (void *)timer->callback;
+        info.arg = timer->arg;
+        info.next_expire_time = timer->next_expire_time;
+        info.interval = timer->interval;
+        ++count;
+        if (fn(&info, arg))
+        {
+            return count;
+        }
+    }
+    /* members of timer groups, the heap only has the driver timer of each group */
+    for (group = ctx->timer_groups; NULL != group; group = group->next)
+    {
+        info.callback = (void *)group->callback;
+        info.interval = group->timeout;
+        for (member = group->head; NULL != member; member = member->next)
+        {
+            info.arg = member->arg;
+            info.next_expire_time = member->next_expire_time;
+            ++count;
+            if (fn(&info, arg))
+            {
+                return count;
+            }
+        }
+    }
+    memset(&info, 0, sizeof(info));
+    info.kind = SW_EV_WATCHER_PREPARE;
+    info.fd = -1;
+    for (i = 0; i < ctx->prepares_count; ++i)
+    {
+        info.callback = (void *)ctx->prepares[i]->callback;
+        info.arg = ctx->prepares[i]->arg;
+        ++count;
+        if (fn(&info, arg))
+        {
+            return count;
+        }
+    }
+    info.kind = SW_EV_WATCHER_CHECK;
+    for (i = 0; i < ctx->checks_count; ++i)
+    {
+        info.callback = (void *)ctx->checks[i]->callback;
+        info.arg = ctx->checks[i]->arg;
+        ++count;
+        if (fn(&info, arg))
+        {
+            return count;
+        }
+    }
+    info.kind = SW_EV_WATCHER_SIGNAL;
+    for (i = 0; NULL != ctx->signal_events && i < SW_EV_NSIG; ++i)
+    {
+        if (NULL != ctx->signal_events[i].callback)
+        {
+            info.fd = i;
+            info.callback = (void *)ctx->signal_events[i].callback;
+            info.arg = ctx->signal_events[i].arg;
+            ++count;
+            if (fn(&info, arg))
+            {
+                return count;
+            }
+        }
+    }
+    return count;
+}
+
+/*
+ * Output of sw_ev_context_dump(), length keeps growing after buf is full like snprintf().
+ */
+struct sw_ev_dump_out
+{
+    char *  buf;
+    size_t  size;
+    size_t  length;
+    int     format;
+    int     count;
+    int64_t now;  /* ms */
+};
+
+static void
+sw_ev_dump_append_(struct sw_ev_dump_out *out, const char *format, ...)
+{
+    va_list args;
+    int n;
+    va_start(args, format);
+    if (out->length < out->size)
+    {
+        n = vsnprintf(out->buf + out->length, out->size - out->length, format, args);
+    }
+    else
+    {
+        n = vsnprintf(NULL, 0, format, args);
+    }
+    va_end(args);
+    if (n > 0)
+    {
+        out->length += n;
+    }
+}
+
+static const char * sw_ev_dump_kind_names_[] =
+{
+    "", "io", "timer", "prepare", "check", "signal"
+};
+
+static int
+sw_ev_dump_watcher_(const sw_ev_watcher_info_t *info, void *arg)
+{
+    struct sw_ev_dump_out *out = (struct sw_ev_dump_out *)arg;
+    const char *name = sw_ev_dump_kind_names_[info->kind];
+    unsigned long long callback = (unsigned long long)(uintptr_t)info->callback;
+    unsigned long long callback_arg = (unsigned long long)(uintptr_t)info->arg;
+    const char *events = (info->events & SW_EV_READ)
+                         ? ((info->events & SW_EV_WRITE) ? "rw" : "r") : "w";
+    if (SW_EV_DUMP_JSON == out->format)
+    {
+        sw_ev_dump_append_(out, "%s{\"kind\":\"%s\"", out->count ? "," : "", name);
+        if (SW_EV_WATCHER_IO == info->kind)
+        {
+            sw_ev_dump_append_(out, ",\"fd\":%d,\"events\":\"%s\"", info->fd, events);
+        }
+        else if (SW_EV_WATCHER_TIMER == info->kind)
+        {
+            sw_ev_dump_append_(out, ",\"expire_in_ms\":%lld,\"interval\":%d",
+                               (long long)(info->next_expire_time - out->now), info->interval);
+        }
+        else if (SW_EV_WATCHER_SIGNAL == info->kind)
+        {
+            sw_ev_dump_append_(out, ",\"signal\":%d", info->fd);
+        }
+        sw_ev_dump_append_(out, ",\"callback\":\"0x%llx\",\"arg\":\"0x%llx\"}", callback, callback_arg);
+    }
+    else
+    {
+        sw_ev_dump_append_(out, "%s", name);
+        if (SW_EV_WATCHER_IO == info->kind)
+        {
+            sw_ev_dump_append_(out, " fd=%d events=%s", info->fd, events);
+        }
+        else if (SW_EV_WATCHER_TIMER == info->kind)
+        {
+            sw_ev_dump_append_(out, " expire_in_ms=%lld interval=%d",
+                               (long long)(info->next_expire_time - out->now), info->interval);
+        }
+        else if (SW_EV_WATCHER_SIGNAL == info->kind)
+        {
+            sw_ev_dump_append_(out, " signal=%d", info->fd);
+        }
+        sw_ev_dump_append_(out, " callback=0x%llx arg=0x%llx\n", callback, callback_arg);
+    }
+    ++out->count;
+    return 0;
+}
+
+int
+sw_ev_context_dump(sw_ev_context_t *ctx, char *buf, size_t size, int format)
+{
+    struct sw_ev_dump_out out;
+    out.buf = buf;
+    out.size = size;
+    out.length = 0;
+    out.format = format;
+    out.count = 0;
+    out.now = sw_ev_gettime_ms();
+    if (size > 0)
+    {
+        buf[0] = '\0';
+    }
+    if (SW_EV_DUMP_JSON == format)
+    {
+        sw_ev_dump_append_(&out, "{\"backend\":\"%s\",\"watchers\":[", sw_ev_backend_name(ctx));
+        sw_ev_watcher_foreach(ctx, sw_ev_dump_watcher_, &out);
+        sw_ev_dump_append_(&out, "]}");
+    }
+    else
+    {
+        sw_ev_dump_append_(&out, "backend %s\n", sw_ev_backend_name(ctx));
+        sw_ev_watcher_foreach(ctx, sw_ev_dump_watcher_, &out);
+    }
+    return (int)out.length;
+}
@@ -0,0 +1,122 @@
+#include "sw_event_internal.h"
+#ifdef __linux__
+#include "sw_log.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+
+/*
+ * epoll backend, fds are registered edge triggered.
+ */
+
+static int
+epoll_init_(sw_ev_context_t *ctx)
+{
+    ctx->backend_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == ctx->backend_fd)
+    {
+        sw_log_error("%s:%d epoll_create1: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+epoll_destroy_(sw_ev_context_t *ctx)
+{
+    if (-1 != ctx->backend_fd)
+    {
+        close(ctx->backend_fd);
+        ctx->backend_fd = -1;
+    }
+}
+
+static int
+epoll_update_(sw_ev_context_t *ctx, int fd, int old_events, int new_events)
+{
+    struct epoll_event ev;
+    int op = EPOLL_CTL_ADD;
+    if (!old_events && !new_events)
+    {
+        return 0;
+    }
+    ev.events = EPOLLET | EPOLLPRI | EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+    ev.data.u64 = fd;
+    if (new_events & SW_EV_READ)
+    {
+        ev.events |= EPOLLIN;
+    }
+    if (new_events & SW_EV_WRITE)
+    {
+        ev.events |= EPOLLOUT;
+    }
+    if (old_events)
+    {
+        op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    }
+    if (epoll_ctl(ctx->backend_fd, op, fd, &ev) != 0)
+    {
+        sw_log_error("%s:%d epoll_ctl: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+epoll_poll_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct epoll_event ready_events[4096];
+    int nfds = 0;
+    int i = 0;
+    int64_t poll_begin_time;
+    poll_begin_time = sw_ev_stats_poll_begin_(ctx);
+    nfds = epoll_wait(ctx->backend_fd, ready_events, sizeof(ready_events)/sizeof(struct epoll_event),  wait_time);
+    sw_ev_stats_poll_end_(ctx, poll_begin_time, nfds);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_POLL, poll_end, nfds);
+    if (nfds == -1)
+    {
+        if (SW_ERRNO != EINTR)
+        {
+            sw_log_error("%s:%d epoll_wait: %d", __FILE__, __LINE__, SW_ERRNO);
+            return -1;
+        }
+    }
+    for (i = 0; i < nfds; i++)
+    {
+        int what_events = 0;
+        if (ready_events[i].events & EPOLLIN)
+        {
+            what_events |= SW_EV_READ;
+        }
+        if (ready_events[i].events & EPOLLOUT)
+        {
+            what_events |= SW_EV_WRITE;
+        }
+        if (ready_events[i].events & (EPOLLPRI | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+        {
+            what_events |= SW_EV_READ;
+        }
+        if (ready_events[i].events & (EPOLLHUP | EPOLLRDHUP))
+        {
+            what_events |= SW_EV_CLOSED;
+        }
+        if (ready_events[i].events & EPOLLERR)
+        {
+            what_events |= SW_EV_ERROR;
+        }
+        if (ready_events[i].events & EPOLLPRI)
+        {
+            what_events |= SW_EV_PRI;
+        }
+        sw_ev_io_dispatch_(ctx, ready_events[i].data.fd, what_events);
+    }
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_IO, io_end, nfds);
+    return 0;
+}
+
+const sw_ev_backend_t sw_ev_backend_epoll_ =
+{
+    "epoll", epoll_init_, epoll_destroy_, epoll_update_, epoll_poll_, NULL
+};
+
+#endif /* __linux__ */
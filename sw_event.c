@@ -3,11 +3,6 @@
 #ifdef _WIN32
     #include <windows.h>
 #else 
-    #if defined(__APPLE__) || defined(__FreeBSD__)
-        #include <sys/event.h>
-    #else
-        #include <sys/epoll.h>
-    #endif
     #include <sys/socket.h>
     #include <unistd.h>
 #endif
@@ -19,24 +14,25 @@
 #include "sw_timer_heap.h"
 #include "sw_log.h"
 #include "sw_util.h"
+#include "sw_event_internal.h"
 
 void* (*sw_ev_malloc)(size_t) = malloc;
 void  (*sw_ev_free)(void *) = free;
 void* (*sw_ev_realloc)(void *, size_t) = realloc;
 
-#ifndef NSIG  /* at most support NSIG signals */
-#define NSIG (64)
-#endif
-
-enum { SW_EV_NSIG = NSIG };
-
 sw_log_func_t log_func = NULL;
+int log_level = SW_LOG_DEBUG;
 
 void sw_set_log_func(sw_log_func_t logfunc)
 {
     log_func = logfunc;
 }
 
+void sw_set_log_level(int level)
+{
+    log_level = level;
+}
+
 static volatile sw_ev_context_t * sw_ev_current_signal_context = NULL;
 
 static void
@@ -69,7 +65,10 @@ sw_ev_sinal_reach_(int fd, int events, void * arg)
             {
                 if (signal_buf[i] < SW_EV_NSIG)
                 {
+                    SW_EV_WATCHDOG_ENTER(ctx, SW_EV_WATCHER_SIGNAL, ctx->signal_events[signal_buf[i]].callback,
+                                         ctx->signal_events[signal_buf[i]].arg);
                     ctx->signal_events[signal_buf[i]].callback(signal_buf[i], ctx->signal_events[signal_buf[i]].arg);
+                    SW_EV_WATCHDOG_LEAVE(ctx);
                 }
             }
         }
@@ -98,17 +97,160 @@ sw_ev_sinal_reach_(int fd, int events, void * arg)
     }
 }
 
+/* available backends, the first one which can be initialized is the default */
+static const sw_ev_backend_t * const sw_ev_backends_[] =
+{
+#ifdef _WIN32
+    &sw_ev_backend_select_,
+#else
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    &sw_ev_backend_kqueue_,
+#endif
+#ifdef __linux__
+    &sw_ev_backend_epoll_,
+#endif
+    &sw_ev_backend_poll_,
+#ifdef SW_EV_IO_URING
+    &sw_ev_backend_io_uring_,
+#endif
+#endif
+    NULL
+};
+
+/*
+ * Initialize the backend named by options or environment variable SW_EV_BACKEND,
+ * or the default one. An unknown or unavailable backend given by options is an error,
+ * given by environment variable it falls back to the default one.
+ */
+static int
+backend_init_(sw_ev_context_t *ctx, const char *name)
+{
+    int name_by_options = NULL != name && '\0' != *name;
+    int i;
+    if (!name_by_options)
+    {
+        name = getenv("SW_EV_BACKEND");
+    }
+    if (NULL != name && '\0' != *name)
+    {
+        for (i = 0; NULL != sw_ev_backends_[i]; ++i)
+        {
+            if (0 == strcmp(name, sw_ev_backends_[i]->name))
+            {
+                ctx->backend = sw_ev_backends_[i];
+                if (0 == ctx->backend->init(ctx))
+                {
+                    return 0;
+                }
+                break;
+            }
+        }
+        sw_log_error("%s:%d backend %s is not available", __FILE__, __LINE__, name);
+        if (name_by_options)
+        {
+            ctx->backend = NULL;
+            return -1;
+        }
+    }
+    for (i = 0; NULL != sw_ev_backends_[i]; ++i)
+    {
+        ctx->backend = sw_ev_backends_[i];
+        if (0 == ctx->backend->init(ctx))
+        {
+            return 0;
+        }
+    }
+    ctx->backend = NULL;
+    return -1;
+}
+
+/*
+ * Create the signal table and the socketpair which signal handler writes to.
+ */
+static int
+signal_init_(sw_ev_context_t *ctx)
+{
+    ctx->signal_events = (sw_ev_signal_t *)sw_ev_malloc(SW_EV_NSIG * sizeof(sw_ev_signal_t));
+    if (NULL == ctx->signal_events)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(ctx->signal_events, 0, SW_EV_NSIG * sizeof(sw_ev_signal_t));
+    if (-1 == sw_ev_socketpair(ctx->signal_pipe))
+    {
+        sw_log_error("%s:%d sw_ev_socketpair: %d", __FILE__, __LINE__, SW_ERRNO);
+        ctx->signal_pipe[0] = -1;
+        ctx->signal_pipe[1] = -1;
+        return -1;
+    }
+    if (-1 == sw_ev_setnonblock(ctx->signal_pipe[0]))
+    {
+        sw_log_error("%s:%d sw_ev_setnonblock: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    if (-1 == sw_ev_setnonblock(ctx->signal_pipe[1]))
+    {
+        sw_log_error("%s:%d sw_ev_setnonblock: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    if (-1 == sw_ev_io_add(ctx, ctx->signal_pipe[0], SW_EV_READ, sw_ev_sinal_reach_, ctx))
+    {
+        sw_log_error("%s:%d sw_ev_io_add: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+signal_destroy_(sw_ev_context_t *ctx)
+{
+    if (-1 != ctx->signal_pipe[0])
+    {
+        sw_ev_io_del(ctx, ctx->signal_pipe[0], SW_EV_READ);
+        SW_EV_CLOSESOCKET(ctx->signal_pipe[0]);
+        SW_EV_CLOSESOCKET(ctx->signal_pipe[1]);
+        ctx->signal_pipe[0] = -1;
+        ctx->signal_pipe[1] = -1;
+    }
+    if (NULL != ctx->signal_events)
+    {
+        sw_ev_free(ctx->signal_events);
+        ctx->signal_events = NULL;
+    }
+}
+
 sw_ev_context_t * 
 sw_ev_context_new()
+{
+    return sw_ev_context_new_ex(NULL);
+}
+
+sw_ev_context_t * 
+sw_ev_context_new_ex(const sw_ev_context_options_t *options)
 {
     sw_ev_context_t *ctx = (sw_ev_context_t *)sw_ev_malloc(sizeof(sw_ev_context_t));
     if (NULL == ctx) 
     {
         return NULL;
     }
+    ctx->io_events = NULL;
+    ctx->timer_heap = NULL;
+    ctx->backend = NULL;
+    ctx->backend_fd = -1;
+    ctx->backend_data = NULL;
+    ctx->signal_events = NULL;
+    ctx->signal_pipe[0] = -1;
+    ctx->signal_pipe[1] = -1;
     ctx->running = 1;
+    ctx->in_loop = 0;
     ctx->current_time = sw_ev_gettime_ms();
-    ctx->io_events_count = 1024;
+    ctx->io_events_min = SW_EV_IO_EVENTS_MIN;
+    if (NULL != options && options->io_events_size > 0)
+    {
+        ctx->io_events_min = options->io_events_size;
+    }
+    ctx->io_events_count = ctx->io_events_min;
     ctx->io_events = (sw_ev_io_t *)sw_ev_malloc(sizeof(sw_ev_io_t) * ctx->io_events_count);
     if (NULL == ctx->io_events)
     {
@@ -127,57 +269,35 @@ sw_ev_context_new()
     ctx->prepares_count = 0;
     memset(ctx->checks, 0, (sizeof(sw_ev_check_t *) * SW_EV_MAX_CHECK));
     ctx->checks_count = 0;
-#ifdef _WIN32
-    FD_ZERO(&ctx->read_set);
-    FD_ZERO(&ctx->write_set);
-    FD_ZERO(&ctx->except_set);
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    ctx->kqueue_fd = kqueue();
-    if (-1 == ctx->kqueue_fd)
-    {
-        sw_log_error_exit("%s:%d kqueue: %d", __FILE__, __LINE__, SW_ERRNO);
-    }
-#else /* linux */
-    ctx->epoll_fd = epoll_create(4096);
-    if (-1 == ctx->epoll_fd)
+    memset(&ctx->stats, 0, sizeof(sw_ev_stats_t));
+    ctx->stats_mark_time = sw_ev_gettime_us();
+    ctx->trim_check_time = ctx->current_time;
+    ctx->trim_low_checks = 0;
+    ctx->profiler = NULL;
+    ctx->tracer = NULL;
+    ctx->watchdog = NULL;
+    ctx->fibers = NULL;
+    ctx->timer_groups = NULL;
+    if (-1 == backend_init_(ctx, NULL != options ? options->backend : NULL))
     {
-        sw_log_error_exit("%s:%d epoll_create: %d", __FILE__, __LINE__, SW_ERRNO);
-    }
-#endif
-    ctx->signal_events = (sw_ev_signal_t *)sw_ev_malloc(SW_EV_NSIG * sizeof(sw_ev_signal_t));
-    if (NULL == ctx->signal_events)
-    {
-        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
         goto oh_no;
     }
-    memset(ctx->signal_events, 0, SW_EV_NSIG * sizeof(sw_ev_signal_t));
-    if (-1 == sw_ev_socketpair(ctx->signal_pipe))
-    {
-        sw_log_error_exit("%s:%d sw_ev_socketpair: %d", __FILE__, __LINE__, SW_ERRNO);
-    }
-    if (-1 == sw_ev_setnonblock(ctx->signal_pipe[0]))
+    if (NULL == options || !(options->flags & SW_EV_CONTEXT_LAZY_SIGNAL))
     {
-        sw_log_error_exit("%s:%d sw_ev_setnonblock: %d", __FILE__, __LINE__, SW_ERRNO);
-    }
-    if (-1 == sw_ev_setnonblock(ctx->signal_pipe[1]))
-    {
-        sw_log_error_exit("%s:%d sw_ev_setnonblock: %d", __FILE__, __LINE__, SW_ERRNO);
-    }
-    if (-1 == sw_ev_io_add(ctx, ctx->signal_pipe[0], SW_EV_READ, sw_ev_sinal_reach_, ctx))
-    {
-        sw_log_error_exit("%s:%d sw_ev_io_add: %d", __FILE__, __LINE__, SW_ERRNO);
+        if (-1 == signal_init_(ctx))
+        {
+            goto oh_no;
+        }
     }
     return ctx;
 oh_no:
     if (NULL != ctx)
     {
-#ifdef _WIN32
-        //nothing
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-        if (ctx->kqueue_fd != -1)    close(ctx->kqueue_fd);
-#else
-        if (ctx->epoll_fd != -1)    close(ctx->epoll_fd);
-#endif
+        signal_destroy_(ctx);
+        if (NULL != ctx->backend)
+        {
+            ctx->backend->destroy(ctx);
+        }
         if (NULL != ctx->io_events)
         {
             sw_ev_free(ctx->io_events);
@@ -206,16 +326,8 @@ sw_ev_context_free(sw_ev_context_t *ctx)
             }
             CAS(&sw_ev_current_signal_context, ctx, NULL);
         }
-        SW_EV_CLOSESOCKET(ctx->signal_pipe[0]);
-        SW_EV_CLOSESOCKET(ctx->signal_pipe[1]);
-        sw_ev_free(ctx->signal_events);
-#ifdef _WIN32
-        //nothing
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-        if (ctx->kqueue_fd != -1)    close(ctx->kqueue_fd);
-#else
-        if (ctx->epoll_fd != -1)    close(ctx->epoll_fd);
-#endif
+        signal_destroy_(ctx);
+        ctx->backend->destroy(ctx);
         for (i = 0; i < ctx->prepares_count; ++i)
         {
             if (ctx->prepares[i])
@@ -230,13 +342,21 @@ sw_ev_context_free(sw_ev_context_t *ctx)
                 sw_ev_free(ctx->checks[i]);
             }
         }
-        for (i = 0; i < ctx->timer_heap->size; ++i)
+        while (NULL != ctx->timer_groups)
         {
-            sw_ev_free(ctx->timer_heap->timers[i]);
+            sw_ev_timer_group_free(ctx->timer_groups); /* with members and driver timer */
+        }
+        for (i = 0; i < sw_timer_heap_size(ctx->timer_heap); ++i)
+        {
+            sw_ev_free(sw_timer_heap_at(ctx->timer_heap, i));
         }
         sw_timer_heap_dtor(ctx->timer_heap);
         sw_ev_free(ctx->timer_heap);
         sw_ev_free(ctx->io_events);
+        sw_ev_profile_disable(ctx);
+        sw_ev_trace_stop(ctx);
+        sw_ev_watchdog_stop(ctx);
+        sw_fiber_sched_destroy_(ctx);
         sw_ev_free(ctx);
     }
 }
@@ -256,11 +376,70 @@ expand_io_events_(sw_ev_context_t *ctx, int max_fd)
         sw_log_error("%s:%d sw_ev_realloc: %d", __FILE__, __LINE__, SW_ERRNO);
         return -1;
     }
+    memset(events + ctx->io_events_count, 0, (capacity - ctx->io_events_count) * sizeof(sw_ev_io_t));
     ctx->io_events_count = capacity;
     ctx->io_events = events;
     return 0;
 }
 
+size_t
+sw_ev_context_trim(sw_ev_context_t *ctx)
+{
+    size_t released = sw_timer_heap_shrink(ctx->timer_heap);
+    int capacity = ctx->io_events_count;
+    int top_fd = ctx->io_events_count - 1;
+    sw_ev_io_t *events;
+    while (top_fd >= 0 && !ctx->io_events[top_fd].events)
+    {
+        --top_fd;
+    }
+    /* the same rule with timer heap, halve while less than a quarter is used */
+    while (capacity > ctx->io_events_min && top_fd < capacity / 4)
+    {
+        capacity >>= 1;
+    }
+    if (capacity < ctx->io_events_count)
+    {
+        events = (sw_ev_io_t *)sw_ev_realloc(ctx->io_events, capacity * sizeof(sw_ev_io_t));
+        if (NULL != events)
+        {
+            released += (ctx->io_events_count - capacity) * sizeof(sw_ev_io_t);
+            ctx->io_events_count = capacity;
+            ctx->io_events = events;
+        }
+    }
+    ctx->trim_low_checks = 0;
+    return released;
+}
+
+/*
+ * Trim memory if tables stay less than a quarter used for SW_EV_TRIM_CHECKS checks.
+ * io_registered is only a hint of the highest fd, sw_ev_context_trim() finds it.
+ */
+static void
+check_trim_(sw_ev_context_t *ctx)
+{
+    if (ctx->current_time - ctx->trim_check_time < SW_EV_TRIM_INTERVAL)
+    {
+        return;
+    }
+    ctx->trim_check_time = ctx->current_time;
+    if ((ctx->io_events_count > ctx->io_events_min
+         && ctx->stats.io_registered < ctx->io_events_count / 4)
+        || (ctx->timer_heap->capacity > 8
+            && sw_timer_heap_size(ctx->timer_heap) < ctx->timer_heap->capacity / 4))
+    {
+        if (++ctx->trim_low_checks >= SW_EV_TRIM_CHECKS)
+        {
+            sw_ev_context_trim(ctx);
+        }
+    }
+    else
+    {
+        ctx->trim_low_checks = 0;
+    }
+}
+
 /*
  * process the expired timers, and return next poll wait time(ms).
  */
@@ -273,12 +452,36 @@ process_timers_(sw_ev_context_t *ctx)
     sw_ev_timer_t * top_timer = sw_timer_heap_top(heap);
     while (NULL != top_timer && curtime >= top_timer->next_expire_time)
     {
-        if (NULL != top_timer->callback)
+        int64_t lateness = curtime - top_timer->next_expire_time;
+        int fire = 1;
+        ctx->stats.timer_lateness_total += lateness;
+        if (lateness > ctx->stats.timer_lateness_max)
+        {
+            ctx->stats.timer_lateness_max = lateness;
+        }
+        sw_timer_heap_pop(heap);
+        if (SW_EV_TIMER_FIRE_ALL == top_timer->catchup || lateness < top_timer->interval)
         {
-            sw_timer_heap_pop(heap);
             top_timer->next_expire_time += top_timer->interval;
-            sw_timer_heap_push(heap, top_timer);
+            top_timer->missed = 0;
+        }
+        else
+        {
+            /* jump to the first aligned tick after curtime in O(1) */
+            int64_t missed = lateness / top_timer->interval;
+            top_timer->next_expire_time += (missed + 1) * top_timer->interval;
+            top_timer->missed = missed > 0x7fffffff ? 0x7fffffff : (int)missed;
+            fire = SW_EV_TIMER_SKIP != top_timer->catchup;
+        }
+        sw_timer_heap_push(heap, top_timer);
+        if (fire && NULL != top_timer->callback)
+        {
+            SW_EV_PROFILE_BEGIN(ctx, top_timer->callback, top_timer->arg);
+            ++ctx->stats.timers_fired;
+            SW_EV_WATCHDOG_ENTER(ctx, SW_EV_WATCHER_TIMER, top_timer->callback, top_timer->arg);
             top_timer->callback(top_timer->arg);
+            SW_EV_WATCHDOG_LEAVE(ctx);
+            SW_EV_PROFILE_END(ctx, SW_EV_PROFILE_TIMER);
         }
         top_timer = sw_timer_heap_top(heap);
     }
@@ -294,13 +497,13 @@ process_timers_(sw_ev_context_t *ctx)
     return next_wait_time;
 }
 
-#ifdef _WIN32
 int
 sw_ev_io_add(sw_ev_context_t *ctx, int fd, int what_events,
              void (*callback)(int fd, int events, void *arg),
              void *arg)
 {
     sw_ev_io_t *ioevent;
+    int now_care_what_events;
     if (fd < 0) return -1;
     if (fd >= ctx->io_events_count)
     {
@@ -314,24 +517,17 @@ sw_ev_io_add(sw_ev_context_t *ctx, int fd, int what_events,
     {
         return -1;
     }
-    if (what_events & SW_EV_READ)
+    ioevent = &ctx->io_events[fd];
+    now_care_what_events = ioevent->events | what_events;
+    if (-1 == ctx->backend->update(ctx, fd, ioevent->events, now_care_what_events))
     {
-        if (ctx->read_set.fd_count >= FD_SETSIZE)
-        {
-            return -1;
-        }
-        FD_SET(fd, &ctx->read_set);
+        return -1;
     }
-    if (what_events & SW_EV_WRITE)
+    if (!ioevent->events)
     {
-        if (ctx->write_set.fd_count >= FD_SETSIZE)
-        {
-            return -1;
-        }
-        FD_SET(fd, &ctx->write_set);
+        ++ctx->stats.io_registered;
     }
-    ioevent = &ctx->io_events[fd];
-    ioevent->events |= what_events;
+    ioevent->events = now_care_what_events;
     ioevent->callback = callback;
     ioevent->arg = arg;
     return 0;
@@ -341,6 +537,7 @@ int
 sw_ev_io_del(sw_ev_context_t *ctx, int fd, int what_events)
 {
     sw_ev_io_t *ioevent;
+    int now_care_what_events;
     if (fd < 0 || fd >= ctx->io_events_count)
     {
         return -1;
@@ -350,461 +547,471 @@ sw_ev_io_del(sw_ev_context_t *ctx, int fd, int what_events)
     {
         return -1;
     }
-    if (what_events & SW_EV_READ)
+    ioevent = &ctx->io_events[fd];
+    if (!ioevent->events)
     {
-        FD_CLR(fd, &ctx->read_set);
+        return 0;
     }
-    if (what_events & SW_EV_WRITE)
+    now_care_what_events = ~what_events & ioevent->events;
+    if (-1 == ctx->backend->update(ctx, fd, ioevent->events, now_care_what_events))
     {
-        FD_CLR(fd, &ctx->write_set);
+        return -1;
     }
-    ioevent = &ctx->io_events[fd];
-    ioevent->events &= ~what_events;
+    ioevent->events = now_care_what_events;
     if (!ioevent->events)
     {
+        --ctx->stats.io_registered;
         ioevent->callback = NULL;
         ioevent->arg = NULL;
     }
     return 0;
 }
 
-struct sw_ev_fd_list
-{
-    int  fds[3*FD_SETSIZE];
-    int  events[3*FD_SETSIZE];
-    int  fd_count;
-};
-
-static void push_to_result_fd_list(struct sw_ev_fd_list * fd_list, int fd, int what_events)
+/*
+ * One loop iteration: expired timers, prepare callbacks, poll-wait and io callbacks,
+ * then check callbacks.
+ */
+static int
+loop_iteration_(sw_ev_context_t *ctx, int flags)
 {
     int i = 0;
-    for ( ; i < fd_list->fd_count; ++i)
+    int wait_time = -1;
+    SW_EV_TRACE_MARK(ctx, -1, loop_begin, 0);
+    SW_EV_WATCHDOG_BEAT(ctx, 0);
+    ctx->current_time = sw_ev_gettime_ms();
+    wait_time = process_timers_(ctx);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_TIMERS, timers_end, 0);
+    check_trim_(ctx);
+    for (i = 0; i < ctx->prepares_count; ++i)
     {
-        if (fd_list->fds[i] == fd)
+        if (NULL != ctx->prepares[i]->callback)
         {
-            fd_list->events[i] |= what_events;
-            return;
+            SW_EV_WATCHDOG_ENTER(ctx, SW_EV_WATCHER_PREPARE, ctx->prepares[i]->callback, ctx->prepares[i]->arg);
+            ctx->prepares[i]->callback(ctx->prepares[i]->arg);
+            SW_EV_WATCHDOG_LEAVE(ctx);
         }
     }
-    if (fd_list->fd_count < 3*FD_SETSIZE)
-    {
-        fd_list->fds[fd_list->fd_count] = fd;
-        fd_list->events[fd_list->fd_count] = what_events;
-        ++fd_list->fd_count;
-    }
-}
-
-int
-sw_ev_loop(sw_ev_context_t *ctx)
-{
-    fd_set read_set, write_set, except_set;
-    int nfds = 0;
-    int i = 0;
-    int wait_time = -1;
-    struct timeval tv = {0, 0};
-    struct sw_ev_fd_list res_fd_list;
-    int fd;
-    sw_ev_io_t *ioevent = NULL;
-    while (ctx->running)
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_PREPARE, prepare_end, ctx->prepares_count);
+    if (!ctx->running) /* sw_ev_loop_exit() called by timer or prepare callbacks */
     {
-        ctx->current_time = sw_ev_gettime_ms();
-        wait_time = process_timers_(ctx);
-        for (i = 0; i < ctx->prepares_count; ++i)
-        {
-            if (NULL != ctx->prepares[i]->callback)
-            {
-                ctx->prepares[i]->callback(ctx->prepares[i]->arg);
-            }
-        }
-        tv.tv_sec = wait_time / 1000;
-        tv.tv_usec = wait_time % 1000 * 1000;
-        memcpy(&read_set, &ctx->read_set, sizeof(fd_set));
-        memcpy(&write_set, &ctx->write_set, sizeof(fd_set));
-        memcpy(&except_set, &ctx->except_set, sizeof(fd_set));
-        memset(&res_fd_list, 0, sizeof(res_fd_list));
-        nfds = select(0, &read_set, &write_set, &except_set, &tv);
-        if (-1 == nfds)
-        {
-            sw_log_error("%s:%d select: %d", __FILE__, __LINE__, SW_ERRNO);
-            return -1;
-        }
-        if (nfds == 0)
-        {
-            continue;
-        }
-        for (i = 0; i < (int)read_set.fd_count; i++)
-        {
-            fd = read_set.fd_array[i];
-            push_to_result_fd_list(&res_fd_list, fd, SW_EV_READ);
-        }
-        for (i = 0; i < (int)write_set.fd_count; i++)
-        {
-            fd = write_set.fd_array[i];
-            push_to_result_fd_list(&res_fd_list, fd, SW_EV_WRITE);
-        }
-        for (i = 0; i < (int)except_set.fd_count; i++)
-        {
-            fd = except_set.fd_array[i];
-            push_to_result_fd_list(&res_fd_list, fd, SW_EV_WRITE);
-        }
-        for (i = 0; i < res_fd_list.fd_count; ++i)
-        {
-            fd = res_fd_list.fds[i];
-            ioevent = &ctx->io_events[fd];
-            if (NULL != ioevent->callback)
-            {
-                ioevent->callback(fd, res_fd_list.events[i], ioevent->arg);
-            }
-        }
-        for (i = 0; i < ctx->checks_count; ++i)
-        {
-            if (NULL != ctx->checks[i]->callback)
-            {
-                ctx->checks[i]->callback(ctx->checks[i]->arg);
-            }
-        }
+        return 0;
     }
-    return 0;
-}
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-int
-sw_ev_io_add(sw_ev_context_t *ctx, int fd, int what_events,
-             void (*callback)(int fd, int events, void *arg),
-             void *arg)
-{
-    
-    if (fd < 0) return -1;
-    if (fd >= ctx->io_events_count)
+    if (flags & SW_EV_RUN_NOWAIT)
     {
-        if (-1 == expand_io_events_(ctx, fd))
-        {
-            return -1;
-        }
+        wait_time = 0;
     }
-    what_events &= SW_EV_READ | SW_EV_WRITE;
-    if (!what_events)
+    if (-1 == ctx->backend->poll(ctx, wait_time))
     {
         return -1;
     }
-    struct kevent kev;
-    if (what_events & SW_EV_READ)
+    for (i = 0; i < ctx->checks_count; ++i)
     {
-        EV_SET(&kev, fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
-        if (-1 == kevent(ctx->kqueue_fd, &kev, 1, NULL, 0, NULL))
+        if (NULL != ctx->checks[i]->callback)
         {
-            sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
-            return -1;
+            SW_EV_WATCHDOG_ENTER(ctx, SW_EV_WATCHER_CHECK, ctx->checks[i]->callback, ctx->checks[i]->arg);
+            ctx->checks[i]->callback(ctx->checks[i]->arg);
+            SW_EV_WATCHDOG_LEAVE(ctx);
         }
     }
-    if (what_events & SW_EV_WRITE)
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_CHECK, check_end, ctx->checks_count);
+    if (flags & SW_EV_RUN_ONCE)
     {
-        EV_SET(&kev, fd, EVFILT_WRITE, EV_ADD, 0, 0, NULL);
-        if (-1 == kevent(ctx->kqueue_fd, &kev, 1, NULL, 0, NULL))
-        {
-            sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
-            return -1;
-        }
+        /* poll-wait may return because of the timer, run it before return to caller */
+        ctx->current_time = sw_ev_gettime_ms();
+        process_timers_(ctx);
+        SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_TIMERS, timers_end, 0);
     }
-    sw_ev_io_t *ioevent = &ctx->io_events[fd];
-    ioevent->events |= what_events;
-    ioevent->callback = callback;
-    ioevent->arg = arg;
+    ++ctx->stats.loop_iterations;
     return 0;
 }
 
 int
-sw_ev_io_del(sw_ev_context_t *ctx, int fd, int what_events)
+sw_ev_loop_run(sw_ev_context_t *ctx, int flags)
 {
-    if (fd < 0 || fd >= ctx->io_events_count)
-    {
-        return -1;
-    }
-    what_events &= SW_EV_READ | SW_EV_WRITE;
-    if (!what_events)
-    {
-        return -1;
-    }
-    struct kevent kev;
-    if (what_events & SW_EV_READ)
-    {
-        EV_SET(&kev, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-        kevent(ctx->kqueue_fd, &kev, 1, NULL, 0, NULL);
-    }
-    if (what_events & SW_EV_WRITE)
+    int ret = 0;
+    int in_loop = ctx->in_loop;
+    ctx->in_loop = 1;
+    ctx->stats_mark_time = sw_ev_gettime_us();
+    while (ctx->running)
     {
-        EV_SET(&kev, fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
-        kevent(ctx->kqueue_fd, &kev, 1, NULL, 0, NULL);
+        if (-1 == loop_iteration_(ctx, flags))
+        {
+            ret = -1;
+            break;
+        }
+        if (flags & (SW_EV_RUN_ONCE | SW_EV_RUN_NOWAIT))
+        {
+            break;
+        }
     }
-    sw_ev_io_t *ioevent = &ctx->io_events[fd];
-    if (!ioevent->events)
+    SW_EV_WATCHDOG_BEAT(ctx, 1);
+    if (0 == ret)
     {
-        return 0;
+        /* account the time after last poll-wait */
+        ctx->stats.busy_time += sw_ev_gettime_us() - ctx->stats_mark_time;
     }
-    ioevent->events = ~what_events & ioevent->events;;
-    if (!ioevent->events)
+    /* re-arm on return, so an exit requested before this run stops it at once */
+    ctx->running = 1;
+    ctx->in_loop = in_loop;
+    /* a host loop watching the backend fd needs the changes made by callbacks */
+    if (!in_loop && NULL != ctx->backend->flush && -1 == ctx->backend->flush(ctx))
     {
-        ioevent->callback = NULL;
-        ioevent->arg = NULL;
+        ret = -1;
     }
-    return 0;
+    return ret;
 }
 
 int
 sw_ev_loop(sw_ev_context_t *ctx)
 {
-    struct kevent ready_events[1024];
-    int nfds = 0;
-    int i = 0;
-    int wait_time = -1;
-    struct timespec timeout;
+    return sw_ev_loop_run(ctx, 0);
+}
 
-    while (ctx->running)
-    {
-        ctx->current_time = sw_ev_gettime_ms();
-        wait_time = process_timers_(ctx);
-        for (i = 0; i < ctx->prepares_count; ++i)
-        {
-            if (NULL != ctx->prepares[i]->callback)
-            {
-                ctx->prepares[i]->callback(ctx->prepares[i]->arg);
-            }
-        }
-        timeout.tv_sec = wait_time / 1000;
-        timeout.tv_nsec = wait_time % 1000 * 1000000;
-        nfds = kevent(ctx->kqueue_fd, NULL, 0, ready_events, sizeof(ready_events)/sizeof(struct kevent), &timeout);
-        if (nfds == -1)
-        {
-            if (SW_ERRNO != EINTR)
-            {
-                sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
-                return -1;
-            }
-        }
-        for (i = 0; i < nfds; i++)
-        {
-            int ev_fd = ready_events[i].ident;
-            sw_ev_io_t *ioevent = &ctx->io_events[ev_fd];
-            int what_events = 0;
-            if (ready_events[i].filter == EVFILT_READ)
-            {
-                what_events |= SW_EV_READ;
-            }
-            if (ready_events[i].filter & EVFILT_WRITE)
-            {
-                what_events |= SW_EV_WRITE;
-            }
-            if (what_events && NULL != ioevent->callback)
-            {
-                ioevent->callback(ev_fd, what_events, ioevent->arg);
-            }
-        }
-        for (i = 0; i < ctx->checks_count; ++i)
-        {
-            if (NULL != ctx->checks[i]->callback)
-            {
-                ctx->checks[i]->callback(ctx->checks[i]->arg);
-            }
-        }
-    }
-    return 0;
+int
+sw_ev_backend_fd(sw_ev_context_t *ctx)
+{
+    return ctx->backend_fd;
+}
+
+const char *
+sw_ev_backend_name(sw_ev_context_t *ctx)
+{
+    return ctx->backend->name;
 }
 
-#else /* linux */
 int
-sw_ev_io_add(sw_ev_context_t *ctx, int fd, int what_events,
-             void (*callback)(int fd, int events, void *arg),
-             void *arg)
+sw_ev_next_timeout(sw_ev_context_t *ctx)
 {
-    if (fd < 0) return -1;
-    if (fd >= ctx->io_events_count)
-    {
-        if (-1 == expand_io_events_(ctx, fd))
-        {
-            return -1;
-        }
-    }
-    what_events &= SW_EV_READ | SW_EV_WRITE;
-    if (!what_events)
+    sw_ev_timer_t *top_timer = sw_timer_heap_top(ctx->timer_heap);
+    int64_t timeout;
+    if (NULL == top_timer)
     {
         return -1;
     }
-    struct epoll_event ev;
-    ev.events = EPOLLET | EPOLLPRI | EPOLLERR | EPOLLHUP;
-    ev.data.u64 = fd;
-    int op = EPOLL_CTL_ADD;
-    sw_ev_io_t *ioevent = &ctx->io_events[fd];
-    int now_care_what_events = ioevent->events | what_events;
-    if (now_care_what_events & SW_EV_READ)
+    timeout = top_timer->next_expire_time - sw_ev_gettime_ms();
+    if (timeout < 0)
     {
-        ev.events |= EPOLLIN;
+        return 0;
     }
-    if (now_care_what_events & SW_EV_WRITE)
+    return timeout > 0x7fffffff ? 0x7fffffff : (int)timeout;
+}
+
+sw_ev_timer_t * 
+sw_ev_timer_add(sw_ev_context_t *ctx, int timeout_ms,
+                void (*callback)(void *arg),
+                void *arg)
+{
+    if (timeout_ms <= 0)
     {
-        ev.events |= EPOLLOUT;
+        return NULL;
     }
-    if (ioevent->events)
+    sw_ev_timer_t *timer = sw_ev_malloc(sizeof(sw_ev_timer_t));
+    if (NULL == timer)
     {
-        op = EPOLL_CTL_MOD;
+        return NULL;
     }
-    if (epoll_ctl(ctx->epoll_fd, op, fd, &ev) != 0)
+    sw_timer_heap_elem_init(timer);
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->interval = timeout_ms;
+    timer->next_expire_time = ctx->current_time + timeout_ms;
+    timer->catchup = SW_EV_TIMER_FIRE_ALL;
+    timer->missed = 0;
+    if (-1 == sw_timer_heap_push(ctx->timer_heap, timer))
     {
-        sw_log_error("%s:%d epoll_ctl: %d", __FILE__, __LINE__, SW_ERRNO);
-        return -1;
+        sw_ev_free(timer);
+        return NULL;
     }
-    ioevent->events = now_care_what_events;
-    ioevent->callback = callback;
-    ioevent->arg = arg;
-    return 0;
+    return timer;
 }
 
 int
-sw_ev_io_del(sw_ev_context_t *ctx, int fd, int what_events)
+sw_ev_timer_del(sw_ev_context_t *ctx, sw_ev_timer_t *timer)
 {
-    if (fd < 0 || fd >= ctx->io_events_count)
-    {
-        return -1;
-    }
-    what_events &= SW_EV_READ | SW_EV_WRITE;
-    if (!what_events)
+    if (NULL == timer)
     {
         return -1;
     }
-    struct epoll_event ev;
-    ev.events = EPOLLET | EPOLLPRI | EPOLLERR | EPOLLHUP;
-    ev.data.u64 = fd;
-    int op = EPOLL_CTL_DEL;
-    sw_ev_io_t *ioevent = &ctx->io_events[fd];
-    if (!ioevent->events)
+    if (timer->index_in_heap != (unsigned)-1)
     {
-        return 0;
+        sw_timer_heap_erase(ctx->timer_heap, timer);
     }
-    int now_care_what_events = ~what_events & ioevent->events;
-    if (now_care_what_events & SW_EV_READ)
+    sw_ev_free(timer);
+    return 0;
+}
+
+int
+sw_ev_timer_set_catchup(sw_ev_timer_t *timer, int policy)
+{
+    if (NULL == timer || policy < SW_EV_TIMER_FIRE_ALL || policy > SW_EV_TIMER_SKIP)
     {
-        ev.events |= EPOLLIN;
+        return -1;
     }
-    if (now_care_what_events & SW_EV_WRITE)
+    timer->catchup = policy;
+    return 0;
+}
+
+static void
+timer_group_unlink_(sw_ev_timer_group_t *group, sw_ev_batch_timer_t *timer)
+{
+    if (NULL != timer->prev) timer->prev->next = timer->next;
+    else group->head = timer->next;
+    if (NULL != timer->next) timer->next->prev = timer->prev;
+    else group->tail = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+static void
+timer_group_append_(sw_ev_timer_group_t *group, sw_ev_batch_timer_t *timer)
+{
+    timer->prev = group->tail;
+    timer->next = NULL;
+    if (NULL != group->tail) group->tail->next = timer;
+    else group->head = timer;
+    group->tail = timer;
+}
+
+/*
+ * Move the driver timer to the head member's expire time, or out of the heap when
+ * the group is empty.
+ */
+static void
+timer_group_rearm_(sw_ev_timer_group_t *group)
+{
+    sw_timer_heap_t *heap = group->ctx->timer_heap;
+    sw_ev_timer_t *driver = group->driver;
+    if (NULL == group->head)
     {
-        ev.events |= EPOLLOUT;
+        if (driver->index_in_heap != (unsigned)-1)
+        {
+            sw_timer_heap_erase(heap, driver);
+        }
+        return;
     }
-    if (now_care_what_events)
+    if (driver->index_in_heap != (unsigned)-1)
     {
-        op = EPOLL_CTL_MOD;
+        if (driver->next_expire_time == group->head->next_expire_time)
+        {
+            return;
+        }
+        sw_timer_heap_erase(heap, driver);
     }
-    if (epoll_ctl(ctx->epoll_fd, op, fd, &ev) != 0)
+    driver->next_expire_time = group->head->next_expire_time;
+    sw_timer_heap_push(heap, driver);
+}
+
+static void
+timer_group_free_deleted_(sw_ev_timer_group_t *group)
+{
+    sw_ev_batch_timer_t *timer;
+    while (NULL != (timer = group->deleted))
     {
-        sw_log_error("%s:%d epoll_ctl: %d", __FILE__, __LINE__, SW_ERRNO);
-        return -1;
+        group->deleted = timer->next;
+        sw_ev_free(timer);
     }
-    ioevent->events = now_care_what_events;
-    if (!ioevent->events)
+}
+
+static void
+timer_group_destroy_(sw_ev_timer_group_t *group)
+{
+    sw_ev_batch_timer_t *timer, *next;
+    for (timer = group->head; NULL != timer; timer = next)
     {
-        ioevent->callback = NULL;
-        ioevent->arg = NULL;
+        next = timer->next;
+        sw_ev_free(timer);
     }
-    return 0;
+    timer_group_free_deleted_(group);
+    if (NULL != group->prev) group->prev->next = group->next;
+    else group->ctx->timer_groups = group->next;
+    if (NULL != group->next) group->next->prev = group->prev;
+    sw_ev_timer_del(group->ctx, group->driver);
+    sw_ev_free(group->expired);
+    sw_ev_free(group);
 }
 
-int
-sw_ev_loop(sw_ev_context_t *ctx)
+static void
+timer_group_expire_(void *arg)
 {
-    struct epoll_event ready_events[4096];
-    int nfds = 0;
-    int i = 0;
-    int wait_time = -1;
-    while (ctx->running)
-    {
-        ctx->current_time = sw_ev_gettime_ms();
-        wait_time = process_timers_(ctx);
-        for (i = 0; i < ctx->prepares_count; ++i)
+    sw_ev_timer_group_t *group = (sw_ev_timer_group_t *)arg;
+    int64_t curtime = group->ctx->current_time;
+    sw_ev_batch_timer_t *timer;
+    sw_ev_batch_timer_t *head_only[1]; /* when the expired array can't be allocated */
+    sw_ev_batch_timer_t **expired = group->expired;
+    int count = 0;
+    while (NULL != (timer = group->head) && timer->next_expire_time <= curtime)
+    {
+        if (count == group->expired_capacity)
         {
-            if (NULL != ctx->prepares[i]->callback)
+            int capacity = group->expired_capacity ? group->expired_capacity * 2 : 64;
+            expired = (sw_ev_batch_timer_t **)sw_ev_realloc(
+                group->expired, capacity * sizeof(sw_ev_batch_timer_t *));
+            if (NULL == expired)
             {
-                ctx->prepares[i]->callback(ctx->prepares[i]->arg);
+                sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+                if (count > 0)
+                {
+                    expired = group->expired;
+                    break;
+                }
+                /* deliver the head alone, so the driver moves on instead of firing again */
+                expired = head_only;
             }
-        }
-        nfds = epoll_wait(ctx->epoll_fd, ready_events, sizeof(ready_events)/sizeof(struct epoll_event),  wait_time);
-        if (nfds == -1)
-        {
-            if (SW_ERRNO != EINTR)
+            else
             {
-                sw_log_error("%s:%d epoll_wait: %d", __FILE__, __LINE__, SW_ERRNO);
-                return -1;
+                group->expired = expired;
+                group->expired_capacity = capacity;
             }
         }
-        for (i = 0; i < nfds; i++)
+        expired[count++] = timer;
+        /* every member expires before curtime + timeout, so the order is kept */
+        timer_group_unlink_(group, timer);
+        timer->next_expire_time = curtime + group->timeout;
+        timer_group_append_(group, timer);
+        if (expired == head_only)
         {
-            int ev_fd = ready_events[i].data.fd;
-            sw_ev_io_t *ioevent = &ctx->io_events[ev_fd];
-            int what_events = 0;
-            if (ready_events[i].events & EPOLLIN)
-            {
-                what_events |= SW_EV_READ;
-            }
-            if (ready_events[i].events & EPOLLOUT)
-            {
-                what_events |= SW_EV_WRITE;
-            }
-            if (ready_events[i].events & (EPOLLPRI | EPOLLERR | EPOLLHUP))
-            {
-                what_events |= SW_EV_READ;
-            }
-            if (what_events && NULL != ioevent->callback)
-            {
-                ioevent->callback(ev_fd, what_events, ioevent->arg);
-            }
+            break;
         }
-        for (i = 0; i < ctx->checks_count; ++i)
+    }
+    if (count > 0)
+    {
+        group->dispatching = 1;
+        SW_EV_WATCHDOG_ENTER(group->ctx, SW_EV_WATCHER_TIMER, group->callback, group->arg);
+        group->callback(expired, count, group->arg);
+        SW_EV_WATCHDOG_LEAVE(group->ctx);
+        group->dispatching = 0;
+        timer_group_free_deleted_(group);
+        if (group->freed)
         {
-            if (NULL != ctx->checks[i]->callback)
-            {
-                ctx->checks[i]->callback(ctx->checks[i]->arg);
-            }
+            timer_group_destroy_(group);
+            return;
         }
     }
-    return 0;
+    timer_group_rearm_(group);
 }
-#endif /* _WIN32 */
 
-sw_ev_timer_t * 
-sw_ev_timer_add(sw_ev_context_t *ctx, int timeout_ms,
-                void (*callback)(void *arg),
-                void *arg)
+sw_ev_timer_group_t *
+sw_ev_timer_group_new(sw_ev_context_t *ctx, int timeout_ms,
+                      void (*callback)(sw_ev_batch_timer_t **timers, int count, void *arg),
+                      void *arg)
 {
-    if (timeout_ms <= 0)
+    sw_ev_timer_group_t *group;
+    if (timeout_ms <= 0 || NULL == callback)
     {
         return NULL;
     }
-    sw_ev_timer_t *timer = sw_ev_malloc(sizeof(sw_ev_timer_t));
+    group = (sw_ev_timer_group_t *)sw_ev_malloc(sizeof(sw_ev_timer_group_t));
+    if (NULL == group)
+    {
+        return NULL;
+    }
+    memset(group, 0, sizeof(sw_ev_timer_group_t));
+    group->ctx = ctx;
+    group->callback = callback;
+    group->arg = arg;
+    group->timeout = timeout_ms;
+    group->driver = sw_ev_timer_add(ctx, timeout_ms, timer_group_expire_, group);
+    if (NULL == group->driver)
+    {
+        sw_ev_free(group);
+        return NULL;
+    }
+    timer_group_rearm_(group); /* empty, take the driver out of the heap */
+    group->next = ctx->timer_groups;
+    if (NULL != ctx->timer_groups)
+    {
+        ctx->timer_groups->prev = group;
+    }
+    ctx->timer_groups = group;
+    return group;
+}
+
+void
+sw_ev_timer_group_free(sw_ev_timer_group_t *group)
+{
+    if (NULL != group)
+    {
+        if (group->dispatching)
+        {
+            group->freed = 1; /* destroyed after callback returned */
+            return;
+        }
+        timer_group_destroy_(group);
+    }
+}
+
+sw_ev_batch_timer_t *
+sw_ev_batch_timer_add(sw_ev_timer_group_t *group, void *arg)
+{
+    sw_ev_batch_timer_t *timer;
+    if (NULL == group || group->freed)
+    {
+        return NULL;
+    }
+    timer = (sw_ev_batch_timer_t *)sw_ev_malloc(sizeof(sw_ev_batch_timer_t));
     if (NULL == timer)
     {
         return NULL;
     }
-    sw_timer_heap_elem_init(timer);
-    timer->callback = callback;
     timer->arg = arg;
-    timer->interval = timeout_ms;
-    timer->next_expire_time = ctx->current_time + timeout_ms;
-    if (-1 == sw_timer_heap_push(ctx->timer_heap, timer))
+    timer->group = group;
+    timer->next_expire_time = group->ctx->current_time + group->timeout;
+    timer_group_append_(group, timer);
+    ++group->members_count;
+    if (group->head == timer)
     {
-        sw_ev_free(timer);
-        return NULL;
+        timer_group_rearm_(group);
     }
     return timer;
 }
 
 int
-sw_ev_timer_del(sw_ev_context_t *ctx, sw_ev_timer_t *timer)
+sw_ev_batch_timer_reset(sw_ev_batch_timer_t *timer)
 {
+    sw_ev_timer_group_t *group;
+    if (NULL == timer || NULL == timer->group)
+    {
+        return -1;
+    }
+    group = timer->group;
+    timer_group_unlink_(group, timer);
+    timer->next_expire_time = group->ctx->current_time + group->timeout;
+    timer_group_append_(group, timer);
+    /* The driver may fire earlier than the new head, it just rearms then. */
+    if (group->head == timer && !group->dispatching)
+    {
+        timer_group_rearm_(group);
+    }
+    return 0;
+}
+
+int
+sw_ev_batch_timer_del(sw_ev_batch_timer_t *timer)
+{
+    sw_ev_timer_group_t *group;
     if (NULL == timer)
     {
         return -1;
     }
-    if (timer->index_in_heap != (unsigned)-1)
+    group = timer->group;
+    if (NULL == group)
     {
-        sw_timer_heap_erase(ctx->timer_heap, timer);
+        return -1; /* already deleted in this callback */
+    }
+    timer_group_unlink_(group, timer);
+    --group->members_count;
+    if (group->dispatching)
+    {
+        /* it may be in the expired array still to be visited, keep it readable */
+        timer->group = NULL;
+        timer->next = group->deleted;
+        group->deleted = timer;
+        return 0;
     }
     sw_ev_free(timer);
+    if (NULL == group->head && !group->dispatching)
+    {
+        timer_group_rearm_(group);
+    }
     return 0;
 }
 
@@ -817,6 +1024,11 @@ sw_ev_signal_add(sw_ev_context_t *ctx, int sig_no,
     {
         return -1;
     }
+    if (NULL == ctx->signal_events && -1 == signal_init_(ctx)) /* SW_EV_CONTEXT_LAZY_SIGNAL */
+    {
+        signal_destroy_(ctx);
+        return -1;
+    }
     if (!CAS(&sw_ev_current_signal_context, NULL, ctx))
     {
         if (sw_ev_current_signal_context != ctx)
@@ -958,6 +1170,23 @@ sw_ev_loop_exit(sw_ev_context_t *ctx)
     ctx->running = 0;
 }
 
+void
+sw_ev_context_stats(sw_ev_context_t *ctx, sw_ev_stats_t *stats)
+{
+    sw_ev_timer_group_t *group;
+    memcpy(stats, &ctx->stats, sizeof(sw_ev_stats_t));
+    stats->timers_registered = (int)sw_timer_heap_size(ctx->timer_heap);
+    /* count members of timer groups instead of their driver timers */
+    for (group = ctx->timer_groups; NULL != group; group = group->next)
+    {
+        stats->timers_registered += group->members_count;
+        if (group->driver->index_in_heap != (unsigned)-1)
+        {
+            --stats->timers_registered;
+        }
+    }
+}
+
 void
 sw_ev_set_memory_func(void* (*malloc_func)(size_t),
                       void  (*free_func)(void *),
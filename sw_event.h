@@ -19,16 +19,38 @@ extern "C"
 {
 #endif
 
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
 enum /* event type */
 {
     SW_EV_READ    = 0x01, /* read ready event */
     SW_EV_WRITE   = 0x02, /* write ready event */
+    /*
+     * Following bits are only reported to io callbacks, needn't be added as interest.
+     * SW_EV_READ is still reported together with them, so a callback only checking
+     * SW_EV_READ finds the condition by recv() as before.
+     */
+    SW_EV_CLOSED  = 0x04, /* peer closed or shut down writing, data may be still readable */
+    SW_EV_ERROR   = 0x08, /* error pending on the socket, get it by SO_ERROR */
+    SW_EV_PRI     = 0x10, /* urgent(out-of-band) data readable */
 };
 
 enum
 {
     SW_EV_MAX_PREPARE = 10,
     SW_EV_MAX_CHECK = 10,
+    SW_EV_IO_EVENTS_MIN = 1024,  /* initial and least size of io events table */
+    SW_EV_TRIM_INTERVAL = 5000,  /* ms */
+    SW_EV_TRIM_CHECKS = 3,
+};
+
+enum /* timer catch-up policy, how to process ticks missed by a stalled loop */
+{
+    SW_EV_TIMER_FIRE_ALL = 0, /* call callback once per missed tick (default) */
+    SW_EV_TIMER_COALESCE = 1, /* call callback once, 'missed' is the count of folded ticks */
+    SW_EV_TIMER_SKIP     = 2, /* drop the missed ticks, call callback on next aligned tick */
 };
 
 typedef struct sw_ev_timer
@@ -38,8 +60,24 @@ typedef struct sw_ev_timer
     int64_t next_expire_time;  /* ms */
     unsigned  index_in_heap; 
     int       interval;  /* ms */
+    int       catchup;   /* SW_EV_TIMER_FIRE_ALL, SW_EV_TIMER_COALESCE or SW_EV_TIMER_SKIP */
+    int       missed;    /* count of ticks dropped before this call, valid in callback */
 } sw_ev_timer_t;
 
+/**
+ * Member of a timer group, see sw_ev_timer_group_new().
+ */
+typedef struct sw_ev_batch_timer
+{
+    void *arg;
+    int64_t next_expire_time;  /* ms */
+    struct sw_ev_timer_group * group; /* NULL once deleted in its group's callback */
+    struct sw_ev_batch_timer * prev;
+    struct sw_ev_batch_timer * next;
+} sw_ev_batch_timer_t;
+
+typedef struct sw_ev_timer_group sw_ev_timer_group_t;
+
 typedef struct sw_ev_io
 {
     void (*callback)(int fd, int events, void *arg);
@@ -75,23 +113,38 @@ typedef struct sw_ev_check
     struct sw_ev_check *next;
 } sw_ev_check_t;
 
+/**
+ * Counters of a sw_ev_context, always updated by the event loop.
+ * Counters are accumulated since sw_ev_context_new(), take two snapshots with
+ * sw_ev_context_stats() and compute the difference to get rates.
+ */
+typedef struct sw_ev_stats
+{
+    uint64_t loop_iterations;
+    uint64_t poll_calls;           /* poll-wait called times */
+    uint64_t poll_ready_events;    /* sum of ready events returned by poll-wait */
+    uint64_t poll_ready_max;       /* max ready events returned by one poll-wait */
+    uint64_t events_dispatched;    /* io event callbacks called times */
+    uint64_t timers_fired;         /* timer callbacks called times */
+    int64_t  timer_lateness_total; /* ms, sum of (fired time - next_expire_time) */
+    int64_t  timer_lateness_max;   /* ms */
+    int64_t  poll_wait_time;       /* us, blocked in poll-wait */
+    int64_t  busy_time;            /* us, out of poll-wait: running callbacks and loop itself */
+    int      io_registered;        /* count of fds which have interested events */
+    int      timers_registered;    /* filled by sw_ev_context_stats() */
+} sw_ev_stats_t;
+
 typedef struct sw_ev_context
 {
     int64_t  current_time; /* ms */
     int      running;
-#ifdef _WIN32
-    fd_set	read_set;
-    fd_set	write_set;
-    fd_set	except_set;
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    int 	kqueue_fd;
-#elif defined(__linux__)
-    int     epoll_fd;
-#else
-#error Not support current operating system yet.
-#endif
+    int      in_loop; /* in sw_ev_loop_run(), backends may batch interest changes */
+    const struct sw_ev_backend * backend; /* poll mechanism, see sw_ev_context_new_ex() */
+    int                          backend_fd; /* epoll, kqueue or io_uring fd, -1 for others */
+    void                       * backend_data;
     struct sw_ev_io * io_events;
     int               io_events_count;
+    int               io_events_min; /* initial and least size of io_events */
     struct sw_timer_heap * timer_heap;
     struct sw_ev_prepare * prepares[SW_EV_MAX_PREPARE];
     int                    prepares_count;
@@ -99,6 +152,15 @@ typedef struct sw_ev_context
     int                    checks_count;
     int                    signal_pipe[2];
     struct sw_ev_signal  * signal_events; /* elements count: NSIG */
+    struct sw_ev_stats     stats;
+    int64_t                stats_mark_time; /* us, last time poll-wait returned */
+    int64_t                trim_check_time; /* ms, last time checked whether to trim memory */
+    int                    trim_low_checks; /* count of successive checks found low occupancy */
+    struct sw_ev_profiler * profiler; /* NULL when callback profiling is disabled */
+    struct sw_ev_tracer   * tracer;   /* NULL when loop tracing is disabled */
+    struct sw_ev_watchdog * watchdog; /* NULL when the watchdog is disabled */
+    struct sw_fiber_sched * fibers;   /* NULL until first sw_fiber_spawn() */
+    struct sw_ev_timer_group * timer_groups; /* all timer groups, freed with ctx */
 } sw_ev_context_t;
 
 /**
@@ -112,6 +174,40 @@ typedef struct sw_ev_context
  */
 sw_ev_context_t * sw_ev_context_new();
 
+/**
+ * Options of sw_ev_context_new_ex(), zero fields mean defaults.
+ */
+enum /* flags of sw_ev_context_options */
+{
+    SW_EV_CONTEXT_LAZY_SIGNAL = 0x01, /* create signal table and socketpair by first sw_ev_signal_add() */
+};
+
+typedef struct sw_ev_context_options
+{
+    const char * backend; /* "epoll", "kqueue", "select", "poll" or "io_uring" */
+    int          io_events_size; /* initial and least size of io events table, default SW_EV_IO_EVENTS_MIN */
+    int          flags; /* bits or of SW_EV_CONTEXT_* */
+} sw_ev_context_options_t;
+
+/**
+ * Alloc and initialize a sw_ev_context with options, then return it.
+ * param:   options - NULL for defaults.
+ * return:  NULL failed, else success.
+ * note:    When options don't name a backend, environment variable SW_EV_BACKEND names it,
+ *          so backends can be compared without rebuilding. Otherwise the default one is
+ *          used: epoll on linux, kqueue on FreeBSD and MAC, select on Windows.
+ *          The epoll and io_uring backends are edge triggered, others are level triggered.
+ *          io_uring backend requires linux 5.13. Its pending poll request keeps the file
+ *          referenced, so call sw_ev_io_del() before close(), else the socket stays open
+ *          until the ctx is freed, unlike epoll. If the poll request fails, the
+ *          callback gets SW_EV_ERROR with the watched events, and the fd isn't watched
+ *          until next sw_ev_io_add().
+ *          For thousands of contexts per process, e.g. one per tenant, use a small
+ *          io_events_size and SW_EV_CONTEXT_LAZY_SIGNAL, then a context costs about 1KB and
+ *          one fd (the epoll fd), or no fd with the poll backend.
+ */
+sw_ev_context_t * sw_ev_context_new_ex(const sw_ev_context_options_t *options);
+
 /**
  * Destroy and free the sw_ev_context.
  * param:   ctx - sw_ev_context you want destroy.
@@ -125,7 +221,8 @@ void sw_ev_context_free(sw_ev_context_t *ctx);
  *          what_events - The bits or of SW_EV_READ and SW_EV_WRITE.
  *          callback - It will be called when events readied. callback's first argument is the
  *          socket which have events readied, second argument offer what events readied, third
- *          argument is the user data pointer.
+ *          argument is the user data pointer. Readied events may also have SW_EV_CLOSED,
+ *          SW_EV_ERROR and SW_EV_PRI bits.
  *          arg - user data pointer.
  * return:  0 success, -1 failed.
  * note:    Socket's read and write event share the same callback function and user data pointer.
@@ -169,6 +266,67 @@ sw_ev_timer_add(sw_ev_context_t *ctx, int timeout_ms,
  */
 int  sw_ev_timer_del(sw_ev_context_t *ctx, sw_ev_timer_t *timer);
 
+/**
+ * Set how the timer catches up after the loop stalled longer than its interval.
+ * With SW_EV_TIMER_COALESCE and SW_EV_TIMER_SKIP, the timer is moved to the first
+ * tick after now aligned to its original schedule in one step, instead of firing
+ * once per missed tick.
+ * param:   timer - timer pointer returned by sw_ev_timer_add().
+ *          policy - SW_EV_TIMER_FIRE_ALL, SW_EV_TIMER_COALESCE or SW_EV_TIMER_SKIP.
+ * return:  0 success, -1 failed.
+ */
+int  sw_ev_timer_set_catchup(sw_ev_timer_t *timer, int policy);
+
+/**
+ * Create a group of timers which have the same timeout and callback, such as idle
+ * checks of connections. Members are kept in a list ordered by expire time, only the
+ * group itself is in the ctx's timer heap, so adding, resetting and deleting a member
+ * are O(1). Expired members are collected in one pass and passed to callback as an array.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          timeout_ms - timeout of every member.
+ *          callback - It will be called with the expired members. callback's first
+ *          argument is the array of expired members, second argument is the count of them,
+ *          third argument is the user data pointer of the group.
+ *          arg - user data pointer.
+ * return:  not NULL success, NULL failed.
+ * note:    An expired member is re-armed timeout_ms later before callback is called, you
+ *          can delete or reset it in callback. A member deleted in callback stays readable
+ *          until callback returns with its group set to NULL, skip such members of the
+ *          array, e.g. the peer of a closed connection deleted earlier in the same call.
+ *          Groups still existing are freed with their members by sw_ev_context_free().
+ */
+sw_ev_timer_group_t *
+sw_ev_timer_group_new(sw_ev_context_t *ctx, int timeout_ms,
+                      void (*callback)(sw_ev_batch_timer_t **timers, int count, void *arg),
+                      void *arg);
+
+/**
+ * Free the timer group and all its members.
+ * It is safe to call it in the group's callback.
+ */
+void sw_ev_timer_group_free(sw_ev_timer_group_t *group);
+
+/**
+ * Add a member to the timer group, it expires timeout_ms later.
+ * param:   group - group pointer returned by sw_ev_timer_group_new().
+ *          arg - user data pointer of the member.
+ * return:  not NULL success, NULL failed.
+ */
+sw_ev_batch_timer_t *
+sw_ev_batch_timer_add(sw_ev_timer_group_t *group, void *arg);
+
+/**
+ * Restart the member's timeout from now, e.g. when the connection is active.
+ * return:  0 success, -1 failed.
+ */
+int  sw_ev_batch_timer_reset(sw_ev_batch_timer_t *timer);
+
+/**
+ * Delete the member from its group and free it.
+ * return:  0 success, -1 failed.
+ */
+int  sw_ev_batch_timer_del(sw_ev_batch_timer_t *timer);
+
 /**
  * Add a signal event to ctx.
  * We just support add or delete signal event in the same sw_ev_context. Once you add
@@ -242,12 +400,300 @@ void sw_ev_check_del(sw_ev_context_t *ctx, sw_ev_check_t *check);
  */
 int  sw_ev_loop(sw_ev_context_t *ctx);
 
+/* flags of sw_ev_loop_run() */
+enum
+{
+    SW_EV_RUN_ONCE   = 0x01,  /* run one iteration, block until io ready or a timer expired, and process it */
+    SW_EV_RUN_NOWAIT = 0x02   /* run one iteration, poll without blocking */
+};
+
+/**
+ * Run event loop on the ctx with flags, so the loop can be driven by a host loop.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          flags - 0 run until sw_ev_loop_exit() called, the same as sw_ev_loop(),
+ *                  or SW_EV_RUN_ONCE, SW_EV_RUN_NOWAIT.
+ * return:  0 if success, -1 if poll-wait failed.
+ * note:    If sw_ev_loop_exit() was called before, e.g. between SW_EV_RUN_ONCE calls,
+ *          it returns at once without running, the exit request is cleared on return.
+ */
+int  sw_ev_loop_run(sw_ev_context_t *ctx, int flags);
+
+/**
+ * Get the fd of backend, it becomes readable when the ctx has io events ready, so a host
+ * loop can watch it and call sw_ev_loop_run(ctx, SW_EV_RUN_NOWAIT) when it is readable.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ * return:  epoll, kqueue or io_uring fd, -1 if the backend has no fd (poll and select).
+ * note:    Interest changes are applied to it when sw_ev_loop_run() returns at the latest.
+ */
+int  sw_ev_backend_fd(sw_ev_context_t *ctx);
+
+/**
+ * Get the name of backend used by the ctx, e.g. "epoll".
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ */
+const char * sw_ev_backend_name(sw_ev_context_t *ctx);
+
+/**
+ * Get the time until the nearest timer expires, a host loop uses it as its poll timeout.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ * return:  milliseconds, 0 if a timer is expired already, -1 if there is no timer.
+ */
+int  sw_ev_next_timeout(sw_ev_context_t *ctx);
+
 /**
  * Exit the event loop.
  * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
  */
 void sw_ev_loop_exit(sw_ev_context_t *ctx);
 
+/**
+ * Release unused capacity of the io events table and timer heap.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ * return:  count of bytes released.
+ * note:    The loop also calls it when less than a quarter of the tables is used for
+ *          SW_EV_TRIM_CHECKS successive checks, SW_EV_TRIM_INTERVAL ms apart, so a
+ *          context gives back memory after a load spike without this call.
+ *          It's fine to call it in an io callback, ready fds beyond the shrunk table
+ *          were deleted, their pending events are skipped.
+ */
+size_t sw_ev_context_trim(sw_ev_context_t *ctx);
+
+/**
+ * Get a snapshot of the ctx's counters.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          stats - output, the counters are copied to it.
+ * note:    It reads counters without locking, call it in the thread running ctx's event loop.
+ */
+void sw_ev_context_stats(sw_ev_context_t *ctx, sw_ev_stats_t *stats);
+
+enum /* kind of watcher */
+{
+    SW_EV_WATCHER_IO      = 1,
+    SW_EV_WATCHER_TIMER   = 2,
+    SW_EV_WATCHER_PREPARE = 3,
+    SW_EV_WATCHER_CHECK   = 4,
+    SW_EV_WATCHER_SIGNAL  = 5,
+};
+
+/**
+ * A registered watcher found by sw_ev_watcher_foreach().
+ */
+typedef struct sw_ev_watcher_info
+{
+    int       kind;             /* SW_EV_WATCHER_* */
+    int       fd;               /* fd of io, signal number of signal, -1 for others */
+    int       events;           /* interest events of io */
+    void    * callback;
+    void    * arg;
+    int64_t   next_expire_time; /* ms, timer only */
+    int       interval;         /* ms, timer only */
+} sw_ev_watcher_info_t;
+
+enum /* format of sw_ev_context_dump() */
+{
+    SW_EV_DUMP_TEXT = 0,  /* one line per watcher */
+    SW_EV_DUMP_JSON = 1,
+};
+
+/**
+ * Walk all registered io events, timers, prepares, checks and signals of ctx.
+ * Each member of a timer group is a timer watcher, with the group's callback and
+ * timeout, the member's arg and expire time.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          fn - It will be called once for every watcher, return non-zero to stop walking.
+ *          Don't add or delete watchers in fn.
+ *          arg - user data pointer, passed to fn.
+ * return:  count of watchers passed to fn.
+ */
+int  sw_ev_watcher_foreach(sw_ev_context_t *ctx,
+                           int (*fn)(const sw_ev_watcher_info_t *info, void *arg),
+                           void *arg);
+
+/**
+ * Write all registered watchers of ctx to buf, to find leaked watchers.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          buf - output, always NUL terminated if size > 0.
+ *          size - size of buf.
+ *          format - SW_EV_DUMP_TEXT or SW_EV_DUMP_JSON.
+ * return:  length of the whole dump excluding NUL like snprintf(), the output is truncated
+ *          if it's not less than size.
+ * note:    It allocates no memory, so it's fine to call it from a debug handler in the
+ *          thread running ctx's event loop.
+ */
+int  sw_ev_context_dump(sw_ev_context_t *ctx, char *buf, size_t size, int format);
+
+/**
+ * Callback profiling, available when libswevent is built with SW_EV_PROFILE defined
+ * (make PROFILE=1). Otherwise the event loop has no instrumentation at all and
+ * sw_ev_profile_enable() always fails.
+ * When enabled, every io and timer callback is timestamped, its run time is
+ * recorded into a log-linear histogram per callback function pointer.
+ */
+enum /* profiled callback kind */
+{
+    SW_EV_PROFILE_IO    = 1,
+    SW_EV_PROFILE_TIMER = 2,
+};
+
+enum
+{
+    /* [0, 16)us has one bucket per us, then 8 buckets per power of 2 until 2^32us */
+    SW_EV_PROFILE_BUCKETS = 16 + 28 * 8,
+};
+
+typedef struct sw_ev_callback_profile
+{
+    void    *callback;   /* callback function pointer */
+    int      kind;       /* SW_EV_PROFILE_IO or SW_EV_PROFILE_TIMER */
+    uint64_t count;
+    int64_t  total_time; /* us */
+    int64_t  max_time;   /* us */
+    uint32_t buckets[SW_EV_PROFILE_BUCKETS];
+} sw_ev_callback_profile_t;
+
+/**
+ * Enable callback profiling on ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          slow_threshold_us - slow_hook is called when a callback runs longer than it,
+ *          0 means never.
+ *          slow_hook - It will be called after the slow callback returned. It's first
+ *          argument is the profile of the callback, second argument is the user data pointer
+ *          of the slow callback (fd's or timer's arg), third argument is the run time of
+ *          this call in us, the last argument is the user data pointer.
+ *          arg - user data pointer.
+ * return:  0 success, -1 failed.
+ * note:    Enable again resets the histograms.
+ */
+int  sw_ev_profile_enable(sw_ev_context_t *ctx, int64_t slow_threshold_us,
+                          void (*slow_hook)(const sw_ev_callback_profile_t *profile,
+                                            void *callback_arg, int64_t elapsed_us,
+                                            void *arg),
+                          void *arg);
+
+/**
+ * Disable callback profiling on ctx and free the histograms.
+ */
+void sw_ev_profile_disable(sw_ev_context_t *ctx);
+
+/**
+ * Walk the profiles of all callbacks called since profiling enabled.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          fn - It will be called once for every callback function.
+ *          arg - user data pointer, passed to fn.
+ * return:  count of profiles, -1 failed.
+ */
+int  sw_ev_profile_foreach(sw_ev_context_t *ctx,
+                           void (*fn)(const sw_ev_callback_profile_t *profile, void *arg),
+                           void *arg);
+
+/**
+ * Get the percentile of a callback's run time.
+ * param:   profile - profile passed by sw_ev_profile_foreach() or slow_hook.
+ *          percentile - in range [0, 100].
+ * return:  upper bound of the histogram bucket holding the percentile(us).
+ */
+int64_t sw_ev_profile_percentile(const sw_ev_callback_profile_t *profile, double percentile);
+
+/**
+ * Loop tracing. When enabled, the time spans of every loop phase are recorded into
+ * a ring buffer of ctx, the newest records overwrite the oldest ones.
+ * Static probes (USDT) named libswevent:loop_begin, timers_end, prepare_end, poll_end,
+ * io_end and check_end are fired at the same points whether tracing enabled or not,
+ * when libswevent is built with <sys/sdt.h> available.
+ */
+enum /* loop phase */
+{
+    SW_EV_TRACE_TIMERS  = 0, /* process expired timers */
+    SW_EV_TRACE_PREPARE = 1, /* call prepare callbacks */
+    SW_EV_TRACE_POLL    = 2, /* poll-wait */
+    SW_EV_TRACE_IO      = 3, /* dispatch io events */
+    SW_EV_TRACE_CHECK   = 4, /* call check callbacks */
+};
+
+/**
+ * Start recording loop phases on ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          capacity - max count of kept records, rounded up to power of 2.
+ * return:  0 success, -1 failed.
+ * note:    Start again discards the recorded spans.
+ */
+int  sw_ev_trace_start(sw_ev_context_t *ctx, unsigned capacity);
+
+/**
+ * Stop recording and free the ring buffer of ctx.
+ */
+void sw_ev_trace_stop(sw_ev_context_t *ctx);
+
+/**
+ * Write the recorded spans to a file in chrome trace JSON format, it can be opened
+ * by chrome://tracing or https://ui.perfetto.dev.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          path - output file path.
+ * return:  count of written spans, -1 failed.
+ * note:    It's safe to dump from other thread, also while the loop thread calls
+ *          sw_ev_trace_start() or sw_ev_trace_stop(), they wait for the records being
+ *          copied. The loop thread writes records without locking, records overwritten
+ *          during copying are dropped.
+ */
+int  sw_ev_trace_dump(sw_ev_context_t *ctx, const char *path);
+
+/**
+ * Stalled loop watchdog. A thread watches the heartbeat of ctx, which is updated at
+ * the begin of every loop iteration and when poll-wait returns. Blocking in poll-wait
+ * is idle, not stalled. The callback being called is recorded before dispatch, so a
+ * stall is reported with the callback which blocks the loop.
+ */
+enum /* flags of sw_ev_watchdog_start() */
+{
+    SW_EV_WATCHDOG_BACKTRACE = 0x01, /* capture the loop thread's backtrace, see below */
+};
+
+enum
+{
+    SW_EV_WATCHDOG_FRAMES = 64, /* max frames of a captured backtrace */
+};
+
+typedef struct sw_ev_stall
+{
+    sw_ev_context_t * ctx;
+    int64_t  stalled_time;  /* ms, since the last heartbeat */
+    int      kind;          /* SW_EV_WATCHER_* of the running callback, 0 for none */
+    void   * callback;      /* running callback, NULL when the loop itself is stalled */
+    void   * arg;           /* user data pointer of the running callback */
+    int64_t  callback_time; /* ms, run time of the callback so far */
+    int      frames_count;  /* 0 when no backtrace captured */
+    void   * frames[SW_EV_WATCHDOG_FRAMES];
+} sw_ev_stall_t;
+
+/**
+ * Start a watchdog thread on ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          threshold_ms - a stall is reported when the heartbeat is older than it.
+ *          flags - bits or of SW_EV_WATCHDOG_*.
+ *          stall_hook - It will be called in the watchdog thread once for each stall.
+ *          NULL to log the stall by sw_log_error, with the symbolized backtrace if any.
+ *          arg - user data pointer, passed to stall_hook.
+ * return:  0 success, -1 failed.
+ * note:    With SW_EV_WATCHDOG_BACKTRACE, signal SIGURG (overridden by defining
+ *          SW_EV_WATCHDOG_SIGNAL when building libswevent) is sent to the loop thread,
+ *          whose handler calls backtrace(). The handler is installed with SA_RESTART,
+ *          but a blocking sleep of the stalled callback may still return early. Signals
+ *          not sent by the watchdog are passed to the previously installed handler, which
+ *          is restored when the last watchdog capturing backtraces stops.
+ *          Backtrace is available on linux, FreeBSD and MAC, not on Windows.
+ *          The watchdog thread reads the recorded callback without locking, so it may
+ *          be mismatched with arg if the loop resumes during reporting.
+ */
+int  sw_ev_watchdog_start(sw_ev_context_t *ctx, int threshold_ms, int flags,
+                          void (*stall_hook)(const sw_ev_stall_t *stall, void *arg),
+                          void *arg);
+
+/**
+ * Stop and join the watchdog thread of ctx.
+ * note:    It must not be called in stall_hook.
+ */
+void sw_ev_watchdog_stop(sw_ev_context_t *ctx);
+
 /**
  * Set the memory manager function instead std dynamic memory manager function.
  */
@@ -276,6 +722,40 @@ typedef void (*sw_log_func_t)(int log_level, const char * msg);
  */
 void sw_set_log_func(sw_log_func_t logfunc);
 
+/**
+ * Drop the messages less severe than level before formatting them.
+ * param:   level - one of SW_LOG_*, default SW_LOG_DEBUG, all messages.
+ * note:    Messages less severe than SW_LOG_MIN_LEVEL, which libswevent is built with,
+ *          are removed at compile time, e.g. make LOG_MIN_LEVEL=2 removes debug ones.
+ */
+void sw_set_log_level(int level);
+
+/**
+ * Start asynchronous logging. A logging thread appends messages to its own lock-free
+ * ring with the arguments captured in binary, a flusher thread formats them later and
+ * calls the log function, so logging never blocks the event loop on I/O, and the log
+ * function needn't be thread-safe any more.
+ * param:   ring_size - bytes of every logging thread's ring, rounded up to power of 2,
+ *          0 for default 64KB.
+ * return:  0 success, -1 failed or already started.
+ * note:    Messages are dropped when a ring is full, the count of dropped ones is logged
+ *          later. Messages are delayed at most about 10ms, a string argument is kept
+ *          at most 1KB. On Windows rings of exited threads are kept until the process exits.
+ */
+int  sw_log_async_start(unsigned ring_size);
+
+/**
+ * Output all queued messages and stop the flusher thread, then the log function is
+ * called synchronously again. Rings are kept, so threads still logging while it
+ * stops don't write freed memory, a message queued too late is output by the next
+ * sw_log_async_start().
+ */
+void sw_log_async_stop();
+
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,240 @@
+/**
+ * Header only C++ layer of libswevent, requires C++11.
+ * Callbacks are template arguments or stored by value in the watcher, the C callback
+ * is a generated thunk calling them directly, so there is no std::function, no heap
+ * allocation and no virtual call, dispatch costs the same as the C api.
+ *
+ *     sw::context ctx;
+ *     auto on_read = [&](int fd, int events) { ... };
+ *     sw::io_watcher<decltype(on_read)> reader(on_read);
+ *     reader.start(ctx, fd, SW_EV_READ);
+ *     sw::timer<void (*)()> ticker(&on_tick);
+ *     ticker.start(ctx, 1000);
+ *     ctx.loop();
+ *
+ * Member functions are bound by sw::member<T, &T::method>, or registered without a
+ * watcher object by sw::io_add<T, &T::method>(ctx, fd, events, obj).
+ */
+#ifndef INC_SW_EVENT_HPP
+#define INC_SW_EVENT_HPP
+
+#include "sw_event.h"
+
+namespace sw
+{
+
+/**
+ * Owner of a sw_ev_context, converted to sw_ev_context_t * implicitly.
+ */
+class context
+{
+public:
+    context() : ctx_(sw_ev_context_new()) {}
+    explicit context(const sw_ev_context_options_t &options) : ctx_(sw_ev_context_new_ex(&options)) {}
+    ~context() { if (NULL != ctx_) sw_ev_context_free(ctx_); }
+    context(context &&other) : ctx_(other.ctx_) { other.ctx_ = NULL; }
+    context & operator=(context &&other)
+    {
+        if (this != &other)
+        {
+            if (NULL != ctx_) sw_ev_context_free(ctx_);
+            ctx_ = other.ctx_;
+            other.ctx_ = NULL;
+        }
+        return *this;
+    }
+
+    sw_ev_context_t * get() const { return ctx_; }
+    operator sw_ev_context_t *() const { return ctx_; }
+    /* false if creating the context failed */
+    explicit operator bool() const { return NULL != ctx_; }
+
+    int  loop() { return sw_ev_loop(ctx_); }
+    int  run(int flags) { return sw_ev_loop_run(ctx_, flags); }
+    void exit() { sw_ev_loop_exit(ctx_); }
+
+private:
+    context(const context &);
+    context & operator=(const context &);
+    sw_ev_context_t * ctx_;
+};
+
+/**
+ * Callable binding a member function to an object, e.g.
+ * sw::io_watcher<sw::member<Session, &Session::on_io>> watcher{sw::member<Session, &Session::on_io>{session}};
+ */
+template <class T, void (T::*Method)(int, int)>
+struct member
+{
+    explicit member(T *object) : object_(object) {}
+    void operator()(int fd, int events) const { (object_->*Method)(fd, events); }
+    T * object_;
+};
+
+template <class T, void (T::*Method)()>
+struct member0
+{
+    explicit member0(T *object) : object_(object) {}
+    void operator()() const { (object_->*Method)(); }
+    T * object_;
+};
+
+/**
+ * Register obj->Method(fd, events) for io events of fd without a watcher object.
+ * return:  the same as sw_ev_io_add().
+ * note:    Unregister it by sw_ev_io_del() before obj is destroyed.
+ */
+template <class T, void (T::*Method)(int, int)>
+inline int io_add(sw_ev_context_t *ctx, int fd, int events, T *obj)
+{
+    struct thunk
+    {
+        static void call(int fd, int events, void *arg)
+        {
+            (static_cast<T *>(arg)->*Method)(fd, events);
+        }
+    };
+    return sw_ev_io_add(ctx, fd, events, &thunk::call, obj);
+}
+
+/**
+ * Io watcher of one fd, callback f(int fd, int events) is kept by value.
+ * It unregisters the events it added when stopped or destroyed. It's fine to stop it
+ * in its own callback, but not to destroy it, which destroys f while f is running.
+ * It can't be copied or moved, because its address is the callback argument.
+ */
+template <class F>
+class io_watcher
+{
+public:
+    explicit io_watcher(const F &f) : f_(f), ctx_(NULL), fd_(-1), events_(0) {}
+    ~io_watcher() { stop(); }
+
+    /**
+     * Watch events of fd, adding to the events already watched.
+     * return:  0 success, -1 failed.
+     */
+    int start(sw_ev_context_t *ctx, int fd, int events)
+    {
+        if (NULL != ctx_ && (ctx_ != ctx || fd_ != fd))
+        {
+            stop();
+        }
+        if (-1 == sw_ev_io_add(ctx, fd, events, &io_watcher::thunk, this))
+        {
+            return -1;
+        }
+        ctx_ = ctx;
+        fd_ = fd;
+        events_ |= events & (SW_EV_READ | SW_EV_WRITE);
+        return 0;
+    }
+
+    /**
+     * Stop watching some events, e.g. SW_EV_WRITE after the pending data sent.
+     */
+    int del(int events)
+    {
+        if (NULL == ctx_ || -1 == sw_ev_io_del(ctx_, fd_, events))
+        {
+            return -1;
+        }
+        events_ &= ~events;
+        if (0 == events_)
+        {
+            ctx_ = NULL;
+            fd_ = -1;
+        }
+        return 0;
+    }
+
+    void stop()
+    {
+        if (NULL != ctx_)
+        {
+            del(events_);
+        }
+    }
+
+    bool active() const { return NULL != ctx_; }
+    int  fd() const { return fd_; }
+    int  events() const { return events_; }
+    F &  callback() { return f_; }
+
+private:
+    io_watcher(const io_watcher &);
+    io_watcher & operator=(const io_watcher &);
+
+    static void thunk(int fd, int events, void *arg)
+    {
+        static_cast<io_watcher *>(arg)->f_(fd, events);
+    }
+
+    F                 f_;
+    sw_ev_context_t * ctx_;
+    int               fd_;
+    int               events_;
+};
+
+/**
+ * Repeating timer, callback f() is kept by value.
+ * It's deleted when stopped or destroyed. It's fine to stop it in its own callback, but
+ * not to destroy it, which destroys f while f is running. It can't be copied or moved,
+ * because its address is the callback argument.
+ */
+template <class F>
+class timer
+{
+public:
+    explicit timer(const F &f) : f_(f), ctx_(NULL), timer_(NULL) {}
+    ~timer() { stop(); }
+
+    /**
+     * Start the timer expiring every timeout_ms, restart it if started.
+     * return:  0 success, -1 failed.
+     */
+    int start(sw_ev_context_t *ctx, int timeout_ms, int catchup = SW_EV_TIMER_FIRE_ALL)
+    {
+        stop();
+        timer_ = sw_ev_timer_add(ctx, timeout_ms, &timer::thunk, this);
+        if (NULL == timer_)
+        {
+            return -1;
+        }
+        ctx_ = ctx;
+        sw_ev_timer_set_catchup(timer_, catchup);
+        return 0;
+    }
+
+    void stop()
+    {
+        if (NULL != timer_)
+        {
+            sw_ev_timer_del(ctx_, timer_);
+            timer_ = NULL;
+            ctx_ = NULL;
+        }
+    }
+
+    bool active() const { return NULL != timer_; }
+    /* missed expirations skipped by catch-up policy before this call */
+    int  missed() const { return NULL != timer_ ? timer_->missed : 0; }
+    F &  callback() { return f_; }
+
+private:
+    timer(const timer &);
+    timer & operator=(const timer &);
+
+    static void thunk(void *arg)
+    {
+        static_cast<timer *>(arg)->f_();
+    }
+
+    F                 f_;
+    sw_ev_context_t * ctx_;
+    sw_ev_timer_t   * timer_;
+};
+
+} /* namespace sw */
+
+#endif
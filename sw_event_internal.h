@@ -0,0 +1,249 @@
+#ifndef INC_SW_EVENT_INTERNAL_H
+#define INC_SW_EVENT_INTERNAL_H
+
+#include "sw_event.h"
+#include "sw_util.h"
+#include <signal.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef NSIG  /* at most support NSIG signals */
+#define NSIG (64)
+#endif
+
+enum { SW_EV_NSIG = NSIG };
+
+#ifdef SW_EV_PROFILE
+
+void sw_ev_profile_record_(sw_ev_context_t *ctx, int kind, void *callback,
+                           void *callback_arg, int64_t begin_time);
+
+/*
+ * Wrap a callback call with SW_EV_PROFILE_BEGIN and SW_EV_PROFILE_END in one block.
+ * callback and callback_arg are saved before the call, because the watcher may be
+ * deleted by the callback itself.
+ */
+#define SW_EV_PROFILE_BEGIN(ctx, callback, callback_arg) \
+    int64_t profile_begin_time_ = (NULL != (ctx)->profiler) ? sw_ev_gettime_us() : 0; \
+    void *profile_callback_ = (void *)(callback); \
+    void *profile_callback_arg_ = (callback_arg)
+
+#define SW_EV_PROFILE_END(ctx, kind) \
+    do { \
+        if (0 != profile_begin_time_) \
+        { \
+            sw_ev_profile_record_((ctx), (kind), profile_callback_, \
+                                  profile_callback_arg_, profile_begin_time_); \
+        } \
+    } while (0)
+
+#else
+
+#define SW_EV_PROFILE_BEGIN(ctx, callback, callback_arg)
+#define SW_EV_PROFILE_END(ctx, kind)
+
+#endif /* SW_EV_PROFILE */
+
+#if !defined(SW_EV_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define SW_EV_USDT
+#endif
+#endif
+
+#ifdef SW_EV_USDT
+#include <sys/sdt.h>
+#define SW_EV_PROBE(name, ctx, count) DTRACE_PROBE2(libswevent, name, ctx, count)
+#else
+#define SW_EV_PROBE(name, ctx, count)
+#endif
+
+void sw_ev_trace_mark_(sw_ev_context_t *ctx, int phase, int count);
+
+/*
+ * Mark the begin of a loop iteration, phase is -1, or the end of a loop phase.
+ * The recorded span of the phase is from previous mark to now.
+ */
+#define SW_EV_TRACE_MARK(ctx, phase, probe_name, count) \
+    do { \
+        SW_EV_PROBE(probe_name, ctx, count); \
+        if (NULL != (ctx)->tracer) \
+        { \
+            sw_ev_trace_mark_((ctx), (phase), (count)); \
+        } \
+    } while (0)
+
+/*
+ * Memory ordering of data shared with other threads (tracing dump, watchdog),
+ * MemoryBarrier() requires <windows.h>.
+ */
+#ifdef _WIN32
+#define SW_EV_LOAD_ACQUIRE(ptr)          (MemoryBarrier(), *(ptr))
+#define SW_EV_STORE_RELEASE(ptr, value)  do { MemoryBarrier(); *(ptr) = (value); } while (0)
+#else
+#define SW_EV_LOAD_ACQUIRE(ptr)          __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SW_EV_STORE_RELEASE(ptr, value)  __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#endif
+
+#ifdef _WIN32
+#define SW_EV_THREAD_LOCAL __declspec(thread)
+#else
+#define SW_EV_THREAD_LOCAL __thread
+#endif
+
+/* free pooled and parked fibers of ctx, called by sw_ev_context_free() */
+void sw_fiber_sched_destroy_(sw_ev_context_t *ctx);
+
+void sw_ev_watchdog_beat_(sw_ev_context_t *ctx, int idle);
+void sw_ev_watchdog_enter_(sw_ev_context_t *ctx, int kind, void *callback, void *callback_arg);
+
+/*
+ * Update the heartbeat, idle is 1 before blocking in poll-wait or leaving the loop.
+ */
+#define SW_EV_WATCHDOG_BEAT(ctx, idle) \
+    do { \
+        if (NULL != (ctx)->watchdog) \
+        { \
+            sw_ev_watchdog_beat_((ctx), (idle)); \
+        } \
+    } while (0)
+
+/*
+ * Record the callback before calling it, and clear it after the call.
+ */
+#define SW_EV_WATCHDOG_ENTER(ctx, kind, callback, callback_arg) \
+    do { \
+        if (NULL != (ctx)->watchdog) \
+        { \
+            sw_ev_watchdog_enter_((ctx), (kind), (void *)(callback), (callback_arg)); \
+        } \
+    } while (0)
+
+#define SW_EV_WATCHDOG_LEAVE(ctx) SW_EV_WATCHDOG_ENTER(ctx, 0, NULL, NULL)
+
+#if defined(_WIN32) && !defined(__cplusplus)
+#define inline __inline
+#endif
+
+/*
+ * Batch timers sharing one timeout, driven by one timer of the heap, see
+ * sw_ev_timer_group_new(). Defined here for sw_ev_watcher_foreach().
+ */
+struct sw_ev_timer_group
+{
+    sw_ev_context_t * ctx;
+    void (*callback)(sw_ev_batch_timer_t **timers, int count, void *arg);
+    void *arg;
+    int   timeout; /* ms */
+    sw_ev_timer_t * driver; /* in ctx's timer heap when the group isn't empty */
+    sw_ev_batch_timer_t * head; /* ordered by next_expire_time */
+    sw_ev_batch_timer_t * tail;
+    int   members_count;
+    sw_ev_batch_timer_t ** expired;
+    int   expired_capacity;
+    int   dispatching;
+    int   freed;
+    sw_ev_batch_timer_t * deleted; /* deleted in callback, freed after it returns */
+    struct sw_ev_timer_group * prev; /* in ctx->timer_groups */
+    struct sw_ev_timer_group * next;
+};
+
+/*
+ * Poll mechanism operations. A backend only keeps the kernel interest of fds, the
+ * io_events table, stats and callbacks are maintained by sw_event.c.
+ */
+typedef struct sw_ev_backend
+{
+    const char * name;
+    /* create state in ctx->backend_fd/backend_data, return -1 if not available */
+    int  (*init)(sw_ev_context_t *ctx);
+    void (*destroy)(sw_ev_context_t *ctx);
+    /* change interest events of fd, old_events is 0 for a new fd, new_events is 0 for removing */
+    int  (*update)(sw_ev_context_t *ctx, int fd, int old_events, int new_events);
+    /* wait ready events at most wait_time ms (-1 infinite) and dispatch them */
+    int  (*poll)(sw_ev_context_t *ctx, int wait_time);
+    /* apply interest changes batched by update, NULL if update applies them at once */
+    int  (*flush)(sw_ev_context_t *ctx);
+} sw_ev_backend_t;
+
+#ifdef _WIN32
+extern const sw_ev_backend_t sw_ev_backend_select_;
+#else
+extern const sw_ev_backend_t sw_ev_backend_poll_;
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__)
+extern const sw_ev_backend_t sw_ev_backend_kqueue_;
+#endif
+#ifdef __linux__
+extern const sw_ev_backend_t sw_ev_backend_epoll_;
+#if !defined(SW_EV_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SW_EV_IO_URING
+#endif
+#endif
+#ifdef SW_EV_IO_URING
+extern const sw_ev_backend_t sw_ev_backend_io_uring_;
+#endif
+#endif
+
+/*
+ * Account the time spent out of poll-wait, and return the time poll-wait begins.
+ */
+static inline int64_t
+sw_ev_stats_poll_begin_(sw_ev_context_t *ctx)
+{
+    int64_t now = sw_ev_gettime_us();
+    ctx->stats.busy_time += now - ctx->stats_mark_time;
+    SW_EV_WATCHDOG_BEAT(ctx, 1);
+    return now;
+}
+
+static inline void
+sw_ev_stats_poll_end_(sw_ev_context_t *ctx, int64_t begin_time, int nfds)
+{
+    ctx->stats_mark_time = sw_ev_gettime_us();
+    SW_EV_WATCHDOG_BEAT(ctx, 0);
+    ctx->stats.poll_wait_time += ctx->stats_mark_time - begin_time;
+    ++ctx->stats.poll_calls;
+    if (nfds > 0)
+    {
+        ctx->stats.poll_ready_events += nfds;
+        if ((uint64_t)nfds > ctx->stats.poll_ready_max)
+        {
+            ctx->stats.poll_ready_max = nfds;
+        }
+    }
+}
+
+/*
+ * Call the io callback of fd, backends call it for every ready fd.
+ * A callback may delete later fds of the batch and shrink io_events by
+ * sw_ev_context_trim(), so fds beyond the table are skipped.
+ */
+static inline void
+sw_ev_io_dispatch_(sw_ev_context_t *ctx, int fd, int what_events)
+{
+    sw_ev_io_t *ioevent;
+    if (fd >= ctx->io_events_count)
+    {
+        return;
+    }
+    ioevent = &ctx->io_events[fd];
+    if (what_events && NULL != ioevent->callback)
+    {
+        SW_EV_PROFILE_BEGIN(ctx, ioevent->callback, ioevent->arg);
+        ++ctx->stats.events_dispatched;
+        SW_EV_WATCHDOG_ENTER(ctx, SW_EV_WATCHER_IO, ioevent->callback, ioevent->arg);
+        ioevent->callback(fd, what_events, ioevent->arg);
+        SW_EV_WATCHDOG_LEAVE(ctx);
+        SW_EV_PROFILE_END(ctx, SW_EV_PROFILE_IO);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
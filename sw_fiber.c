@@ -0,0 +1,610 @@
+#include "sw_fiber.h"
+#include "sw_event_internal.h"
+#include "sw_log.h"
+#include "sw_util.h"
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#define SW_FIBER_WIN
+#define SW_FIBER_EAGAIN  WSAEWOULDBLOCK
+#define SW_FIBER_EINTR   WSAEINTR
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SW_FIBER_EAGAIN  EAGAIN
+#define SW_FIBER_EINTR   EINTR
+#if defined(SW_FIBER_UCONTEXT) || !defined(__GNUC__) \
+    || (!defined(__x86_64__) && !defined(__aarch64__))
+#undef SW_FIBER_UCONTEXT
+#define SW_FIBER_UCONTEXT
+#include <ucontext.h>
+#endif
+#endif
+
+struct sw_fiber
+{
+    sw_ev_context_t * ctx;
+    void           (* fn)(void *arg);
+    void            * arg;
+    int               done;
+    int               ready_events; /* set by the io callback which resumes the fiber */
+    struct sw_fiber * prev;         /* live fibers, or the free list of pooled ones */
+    struct sw_fiber * next;
+#if defined(SW_FIBER_WIN)
+    LPVOID            handle;
+    LPVOID            caller;
+#else
+    void            * stack_base;   /* mapping with guard page, the fiber is at its top */
+    size_t            stack_total;
+#if defined(SW_FIBER_UCONTEXT)
+    ucontext_t        uc;
+    ucontext_t        caller_uc;
+#else
+    void            * sp;           /* saved stack pointer of the fiber */
+    void            * caller_sp;    /* saved stack pointer of the resumer */
+#endif
+#endif
+};
+
+struct sw_fiber_sched
+{
+    size_t       stack_size;
+    int          pool_max;
+    int          pool_count;
+    sw_fiber_t * pool; /* finished fibers keeping their stacks */
+    sw_fiber_t * live;
+};
+
+static SW_EV_THREAD_LOCAL sw_fiber_t * sw_fiber_current_ = NULL;
+
+#if !defined(SW_FIBER_WIN) && !defined(SW_FIBER_UCONTEXT)
+
+/*
+ * sw_fiber_switch_(save_sp, load_sp) pushes callee-saved registers, saves the stack
+ * pointer to *save_sp, then loads load_sp and pops the registers saved there.
+ * A new fiber's stack is made to return into sw_fiber_trampoline_, which calls
+ * sw_fiber_main_() with the fiber held in a callee-saved register.
+ */
+#ifdef __APPLE__
+#define SW_FIBER_SYM(name)   "_" #name
+#define SW_FIBER_FUNC(name)  ".globl _" #name "\n.private_extern _" #name "\n_" #name ":\n"
+#elif defined(__aarch64__)
+#define SW_FIBER_SYM(name)   #name
+#define SW_FIBER_FUNC(name)  ".globl " #name "\n.hidden " #name "\n.type " #name ", %function\n" #name ":\n"
+#else
+#define SW_FIBER_SYM(name)   #name
+#define SW_FIBER_FUNC(name)  ".globl " #name "\n.hidden " #name "\n.type " #name ", @function\n" #name ":\n"
+#endif
+
+void sw_fiber_switch_(void **save_sp, void *load_sp);
+void sw_fiber_trampoline_(void);
+__attribute__((visibility("hidden"), used)) void sw_fiber_main_(sw_fiber_t *fiber);
+
+#if defined(__x86_64__)
+
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    SW_FIBER_FUNC(sw_fiber_switch_)
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".p2align 4\n"
+    SW_FIBER_FUNC(sw_fiber_trampoline_)
+    "    movq %rbx, %rdi\n"
+    "    call " SW_FIBER_SYM(sw_fiber_main_) "\n"
+    "    ud2\n"
+);
+
+enum { SW_FIBER_FRAME_SIZE = 80 }; /* mxcsr and fpu control word, 6 registers, return address, pad */
+
+static void
+sw_fiber_init_frame_(sw_fiber_t *fiber, char *stack_top)
+{
+    uint64_t *frame = (uint64_t *)(stack_top - SW_FIBER_FRAME_SIZE);
+    memset(frame, 0, SW_FIBER_FRAME_SIZE);
+    ((uint32_t *)frame)[0] = 0x1f80;      /* mxcsr default */
+    ((uint16_t *)frame)[2] = 0x037f;      /* x87 control word default */
+    frame[5] = (uint64_t)(uintptr_t)fiber; /* rbx */
+    frame[7] = (uint64_t)(uintptr_t)sw_fiber_trampoline_; /* return address */
+    fiber->sp = frame;
+}
+
+#else /* __aarch64__ */
+
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    SW_FIBER_FUNC(sw_fiber_switch_)
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    ".p2align 4\n"
+    SW_FIBER_FUNC(sw_fiber_trampoline_)
+    "    mov x0, x19\n"
+    "    bl " SW_FIBER_SYM(sw_fiber_main_) "\n"
+    "    brk #0\n"
+);
+
+enum { SW_FIBER_FRAME_SIZE = 176 }; /* x19-x30, d8-d15, pad */
+
+static void
+sw_fiber_init_frame_(sw_fiber_t *fiber, char *stack_top)
+{
+    uint64_t *frame = (uint64_t *)(stack_top - SW_FIBER_FRAME_SIZE);
+    memset(frame, 0, SW_FIBER_FRAME_SIZE);
+    frame[0] = (uint64_t)(uintptr_t)fiber;  /* x19 */
+    frame[11] = (uint64_t)(uintptr_t)sw_fiber_trampoline_; /* x30 */
+    fiber->sp = frame;
+}
+
+#endif /* __x86_64__ */
+
+#define SW_FIBER_SWITCH_IN(fiber)   sw_fiber_switch_(&(fiber)->caller_sp, (fiber)->sp)
+#define SW_FIBER_SWITCH_OUT(fiber)  sw_fiber_switch_(&(fiber)->sp, (fiber)->caller_sp)
+
+#elif defined(SW_FIBER_UCONTEXT)
+
+static void sw_fiber_main_(sw_fiber_t *fiber);
+
+/* makecontext() passes int arguments only */
+static void
+sw_fiber_uc_entry_(unsigned int low, unsigned int high)
+{
+    sw_fiber_main_((sw_fiber_t *)(uintptr_t)(((uint64_t)high << 32) | low));
+}
+
+#define SW_FIBER_SWITCH_IN(fiber)   swapcontext(&(fiber)->caller_uc, &(fiber)->uc)
+#define SW_FIBER_SWITCH_OUT(fiber)  swapcontext(&(fiber)->uc, &(fiber)->caller_uc)
+
+#else /* SW_FIBER_WIN */
+
+static void sw_fiber_main_(sw_fiber_t *fiber);
+
+static VOID CALLBACK
+sw_fiber_win_entry_(LPVOID arg)
+{
+    sw_fiber_main_((sw_fiber_t *)arg);
+}
+
+#define SW_FIBER_SWITCH_IN(fiber) \
+    do { \
+        (fiber)->caller = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(NULL); \
+        SwitchToFiber((fiber)->handle); \
+    } while (0)
+#define SW_FIBER_SWITCH_OUT(fiber)  SwitchToFiber((fiber)->caller)
+
+#endif
+
+void
+sw_fiber_main_(sw_fiber_t *fiber)
+{
+    fiber->fn(fiber->arg);
+    fiber->done = 1;
+    SW_FIBER_SWITCH_OUT(fiber); /* never resumed */
+}
+
+static void
+sw_fiber_unmap_(sw_fiber_t *fiber)
+{
+#ifdef SW_FIBER_WIN
+    DeleteFiber(fiber->handle);
+    sw_ev_free(fiber);
+#else
+    munmap(fiber->stack_base, fiber->stack_total);
+#endif
+}
+
+static struct sw_fiber_sched *
+sw_fiber_sched_get_(sw_ev_context_t *ctx)
+{
+    struct sw_fiber_sched *sched = ctx->fibers;
+    if (NULL == sched)
+    {
+        sched = (struct sw_fiber_sched *)sw_ev_malloc(sizeof(struct sw_fiber_sched));
+        if (NULL == sched)
+        {
+            sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+            return NULL;
+        }
+        memset(sched, 0, sizeof(struct sw_fiber_sched));
+        sched->stack_size = SW_FIBER_STACK_SIZE;
+        sched->pool_max = SW_FIBER_POOL_MAX;
+        ctx->fibers = sched;
+    }
+    return sched;
+}
+
+static void
+sw_fiber_pool_clear_(struct sw_fiber_sched *sched)
+{
+    sw_fiber_t *fiber;
+    while (NULL != (fiber = sched->pool))
+    {
+        sched->pool = fiber->next;
+        sw_fiber_unmap_(fiber);
+    }
+    sched->pool_count = 0;
+}
+
+void
+sw_fiber_sched_destroy_(sw_ev_context_t *ctx)
+{
+    struct sw_fiber_sched *sched = ctx->fibers;
+    sw_fiber_t *fiber;
+    if (NULL == sched)
+    {
+        return;
+    }
+    sw_fiber_pool_clear_(sched);
+    while (NULL != (fiber = sched->live))
+    {
+        sched->live = fiber->next;
+        sw_fiber_unmap_(fiber);
+    }
+    sw_ev_free(sched);
+    ctx->fibers = NULL;
+}
+
+/*
+ * Take a pooled fiber or map a new stack with a guard page, the fiber is put at the
+ * top of its stack.
+ */
+static sw_fiber_t *
+sw_fiber_alloc_(struct sw_fiber_sched *sched)
+{
+    sw_fiber_t *fiber = sched->pool;
+#ifndef SW_FIBER_WIN
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t total;
+    char *base;
+#endif
+    if (NULL != fiber)
+    {
+        sched->pool = fiber->next;
+        --sched->pool_count;
+        return fiber;
+    }
+#ifdef SW_FIBER_WIN
+    fiber = (sw_fiber_t *)sw_ev_malloc(sizeof(sw_fiber_t));
+    if (NULL == fiber)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(fiber, 0, sizeof(sw_fiber_t));
+    fiber->handle = CreateFiber(sched->stack_size, sw_fiber_win_entry_, fiber);
+    if (NULL == fiber->handle)
+    {
+        sw_log_error("%s:%d CreateFiber: %d", __FILE__, __LINE__, SW_ERRNO);
+        sw_ev_free(fiber);
+        return NULL;
+    }
+#else
+    total = sched->stack_size + page;
+#ifdef MAP_STACK
+    base = (char *)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+#else
+    base = (char *)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+    if (MAP_FAILED == base)
+    {
+        sw_log_error("%s:%d mmap: %d", __FILE__, __LINE__, SW_ERRNO);
+        return NULL;
+    }
+    if (-1 == mprotect(base, page, PROT_NONE))
+    {
+        sw_log_error("%s:%d mprotect: %d", __FILE__, __LINE__, SW_ERRNO);
+        munmap(base, total);
+        return NULL;
+    }
+    fiber = (sw_fiber_t *)((uintptr_t)(base + total - sizeof(sw_fiber_t)) & ~(uintptr_t)63);
+    memset(fiber, 0, sizeof(sw_fiber_t));
+    fiber->stack_base = base;
+    fiber->stack_total = total;
+#endif
+    return fiber;
+}
+
+/*
+ * Give back a finished fiber, its stack is kept if the pool isn't full.
+ */
+static void
+sw_fiber_release_(sw_ev_context_t *ctx, sw_fiber_t *fiber)
+{
+    struct sw_fiber_sched *sched = ctx->fibers;
+    if (NULL != fiber->prev)
+    {
+        fiber->prev->next = fiber->next;
+    }
+    else
+    {
+        sched->live = fiber->next;
+    }
+    if (NULL != fiber->next)
+    {
+        fiber->next->prev = fiber->prev;
+    }
+#ifdef SW_FIBER_WIN
+    sw_fiber_unmap_(fiber); /* a finished windows fiber can't be restarted */
+#else
+    if (sched->pool_count < sched->pool_max
+        && fiber->stack_total == sched->stack_size + (size_t)sysconf(_SC_PAGESIZE))
+    {
+        fiber->prev = NULL;
+        fiber->next = sched->pool;
+        sched->pool = fiber;
+        ++sched->pool_count;
+    }
+    else
+    {
+        sw_fiber_unmap_(fiber);
+    }
+#endif
+}
+
+/*
+ * Switch from the caller to fiber, return when the fiber parked or finished.
+ */
+static void
+sw_fiber_resume_(sw_fiber_t *fiber)
+{
+    sw_fiber_t *previous = sw_fiber_current_;
+    sw_fiber_current_ = fiber;
+    SW_FIBER_SWITCH_IN(fiber);
+    sw_fiber_current_ = previous;
+    if (fiber->done)
+    {
+        sw_fiber_release_(fiber->ctx, fiber);
+    }
+}
+
+int
+sw_fiber_config(sw_ev_context_t *ctx, size_t stack_size, int pool_max)
+{
+    struct sw_fiber_sched *sched = sw_fiber_sched_get_(ctx);
+    if (NULL == sched)
+    {
+        return -1;
+    }
+    if (stack_size > 0)
+    {
+#ifndef SW_FIBER_WIN
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        stack_size = (stack_size + page - 1) / page * page;
+#endif
+        if (stack_size != sched->stack_size)
+        {
+            sw_fiber_pool_clear_(sched);
+            sched->stack_size = stack_size;
+        }
+    }
+    if (pool_max >= 0)
+    {
+        sched->pool_max = pool_max;
+        while (sched->pool_count > pool_max)
+        {
+            sw_fiber_t *fiber = sched->pool;
+            sched->pool = fiber->next;
+            --sched->pool_count;
+            sw_fiber_unmap_(fiber);
+        }
+    }
+    return 0;
+}
+
+int
+sw_fiber_spawn(sw_ev_context_t *ctx, void (*fn)(void *arg), void *arg)
+{
+    struct sw_fiber_sched *sched = sw_fiber_sched_get_(ctx);
+    sw_fiber_t *fiber;
+    if (NULL == sched || NULL == fn)
+    {
+        return -1;
+    }
+    fiber = sw_fiber_alloc_(sched);
+    if (NULL == fiber)
+    {
+        return -1;
+    }
+    fiber->ctx = ctx;
+    fiber->fn = fn;
+    fiber->arg = arg;
+    fiber->done = 0;
+    fiber->prev = NULL;
+    fiber->next = sched->live;
+    if (NULL != sched->live)
+    {
+        sched->live->prev = fiber;
+    }
+    sched->live = fiber;
+#if defined(SW_FIBER_UCONTEXT)
+    if (-1 == getcontext(&fiber->uc))
+    {
+        sw_log_error("%s:%d getcontext: %d", __FILE__, __LINE__, SW_ERRNO);
+        sw_fiber_release_(ctx, fiber);
+        return -1;
+    }
+    fiber->uc.uc_stack.ss_sp = (char *)fiber->stack_base + (fiber->stack_total - sched->stack_size);
+    fiber->uc.uc_stack.ss_size = (char *)fiber - (char *)fiber->uc.uc_stack.ss_sp;
+    fiber->uc.uc_link = NULL;
+    makecontext(&fiber->uc, (void (*)(void))sw_fiber_uc_entry_, 2,
+                (unsigned int)(uintptr_t)fiber, (unsigned int)((uint64_t)(uintptr_t)fiber >> 32));
+#elif !defined(SW_FIBER_WIN)
+    sw_fiber_init_frame_(fiber, (char *)((uintptr_t)fiber & ~(uintptr_t)15));
+#endif
+    sw_fiber_resume_(fiber);
+    return 0;
+}
+
+sw_fiber_t *
+sw_fiber_current()
+{
+    return sw_fiber_current_;
+}
+
+sw_ev_context_t *
+sw_fiber_context()
+{
+    return NULL != sw_fiber_current_ ? sw_fiber_current_->ctx : NULL;
+}
+
+static void
+sw_fiber_io_ready_(int fd, int events, void *arg)
+{
+    sw_fiber_t *fiber = (sw_fiber_t *)arg;
+    fiber->ready_events = events;
+    sw_fiber_resume_(fiber);
+}
+
+int
+sw_fiber_wait_io(int fd, int what_events)
+{
+    sw_fiber_t *fiber = sw_fiber_current_;
+    if (NULL == fiber)
+    {
+        errno = EPERM;
+        return -1;
+    }
+    if (fd >= 0 && fd < fiber->ctx->io_events_count && fiber->ctx->io_events[fd].events
+        && (sw_fiber_io_ready_ != fiber->ctx->io_events[fd].callback
+            || fiber != fiber->ctx->io_events[fd].arg))
+    {
+        /* sw_ev_io_add() would take over the callback of another waiter */
+        errno = EBUSY;
+        return -1;
+    }
+    if (-1 == sw_ev_io_add(fiber->ctx, fd, what_events, sw_fiber_io_ready_, fiber))
+    {
+        return -1;
+    }
+    fiber->ready_events = 0;
+    SW_FIBER_SWITCH_OUT(fiber);
+    sw_ev_io_del(fiber->ctx, fd, what_events);
+    return fiber->ready_events;
+}
+
+long
+sw_fiber_read(int fd, void *buf, size_t len)
+{
+    long n;
+    while (1)
+    {
+#ifdef _WIN32
+        n = recv(fd, (char *)buf, (int)len, 0);
+#else
+        n = (long)read(fd, buf, len);
+#endif
+        if (n >= 0)
+        {
+            return n;
+        }
+        if (SW_ERRNO == SW_FIBER_EINTR)
+        {
+            continue;
+        }
+        if (SW_ERRNO != SW_FIBER_EAGAIN || -1 == sw_fiber_wait_io(fd, SW_EV_READ))
+        {
+            return -1;
+        }
+    }
+}
+
+long
+sw_fiber_write(int fd, const void *buf, size_t len)
+{
+    size_t written = 0;
+    long n;
+    while (written < len)
+    {
+#ifdef _WIN32
+        n = send(fd, (const char *)buf + written, (int)(len - written), 0);
+#else
+        n = (long)write(fd, (const char *)buf + written, len - written);
+#endif
+        if (n >= 0)
+        {
+            written += n;
+            continue;
+        }
+        if (SW_ERRNO == SW_FIBER_EINTR)
+        {
+            continue;
+        }
+        if (SW_ERRNO != SW_FIBER_EAGAIN || -1 == sw_fiber_wait_io(fd, SW_EV_WRITE))
+        {
+            return -1;
+        }
+    }
+    return (long)len;
+}
+
+static void
+sw_fiber_timeout_(void *arg)
+{
+    sw_fiber_resume_((sw_fiber_t *)arg);
+}
+
+int
+sw_fiber_sleep(int timeout_ms)
+{
+    sw_fiber_t *fiber = sw_fiber_current_;
+    sw_ev_timer_t *timer;
+    if (NULL == fiber)
+    {
+        errno = EPERM;
+        return -1;
+    }
+    timer = sw_ev_timer_add(fiber->ctx, timeout_ms, sw_fiber_timeout_, fiber);
+    if (NULL == timer)
+    {
+        return -1;
+    }
+    SW_FIBER_SWITCH_OUT(fiber);
+    sw_ev_timer_del(fiber->ctx, timer);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * Stackful fibers for libswevent.
+ * A fiber runs blocking style code on the thread of its sw_ev_context. When it calls
+ * sw_fiber_read(), sw_fiber_write(), sw_fiber_wait_io() or sw_fiber_sleep() and
+ * would block, the fiber is parked on the io events or a timer of the context and
+ * sw_ev_loop() goes on, the fiber is resumed inside the io or timer callback.
+ * Context switching is hand-written for x86-64 and aarch64, other platforms use
+ * ucontext (or define SW_FIBER_UCONTEXT when building to force it), Windows uses
+ * its native fibers. Stacks are mmap'd with a guard page under them and pooled
+ * per context.
+ */
+#ifndef INC_SW_FIBER_H
+#define INC_SW_FIBER_H
+
+#include "sw_event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+enum
+{
+    SW_FIBER_STACK_SIZE = 128 * 1024, /* default stack size of a fiber */
+    SW_FIBER_POOL_MAX   = 64,         /* default max count of pooled stacks of a context */
+};
+
+typedef struct sw_fiber sw_fiber_t;
+
+/**
+ * Set stack size of the fibers created later and max count of pooled free stacks.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          stack_size - bytes, rounded up to page size, 0 keeps the current one.
+ *          pool_max - max count of free stacks kept for reuse, -1 keeps the current one.
+ * return:  0 success, -1 failed.
+ * note:    A fiber overflowing its stack is killed by SIGSEGV on the guard page, keep
+ *          large buffers off the stack.
+ */
+int  sw_fiber_config(sw_ev_context_t *ctx, size_t stack_size, int pool_max);
+
+/**
+ * Create a fiber running fn(arg) and switch to it at once, return when it parked
+ * or finished.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          fn - fiber function, the fiber finishes when it returns.
+ *          arg - user data pointer passed to fn.
+ * return:  0 success, -1 failed.
+ * note:    It can be called in or out of a fiber. Fibers still parked when ctx is
+ *          freed are freed without resuming them.
+ */
+int  sw_fiber_spawn(sw_ev_context_t *ctx, void (*fn)(void *arg), void *arg);
+
+/**
+ * Get the running fiber, NULL if not called in a fiber.
+ */
+sw_fiber_t * sw_fiber_current();
+
+/**
+ * Get the context of the running fiber, NULL if not called in a fiber.
+ */
+sw_ev_context_t * sw_fiber_context();
+
+/**
+ * Park the running fiber until events of fd are ready.
+ * param:   fd - socket or pipe.
+ *          what_events - SW_EV_READ or SW_EV_WRITE.
+ * return:  ready events (bits or of SW_EV_*), -1 failed or not called in a fiber.
+ * note:    fd has one callback in a context, so only one fiber can wait it at a time,
+ *          it fails with errno EBUSY if another fiber or callback is watching fd.
+ */
+int  sw_fiber_wait_io(int fd, int what_events);
+
+/**
+ * Read like read(), park the running fiber while fd has no data.
+ * param:   fd - non-blocking fd, set by sw_ev_setnonblock().
+ * return:  count of read bytes, 0 on end of file, -1 failed with errno set.
+ */
+long sw_fiber_read(int fd, void *buf, size_t len);
+
+/**
+ * Write all len bytes, park the running fiber while fd is not writable.
+ * param:   fd - non-blocking fd, set by sw_ev_setnonblock().
+ * return:  len, -1 failed with errno set.
+ */
+long sw_fiber_write(int fd, const void *buf, size_t len);
+
+/**
+ * Park the running fiber for timeout_ms.
+ * return:  0 success, -1 failed or not called in a fiber.
+ */
+int  sw_fiber_sleep(int timeout_ms);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
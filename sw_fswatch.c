@@ -0,0 +1,562 @@
+#include "sw_fswatch.h"
+#include "sw_log.h"
+#include "sw_util.h"
+
+#ifdef __linux__
+
+#include <sys/types.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+typedef struct sw_ev_fswatch_entry /* one watched path */
+{
+    int   wd;
+    char *path;
+    struct sw_ev_fswatch_entry *next;
+} sw_ev_fswatch_entry_t;
+
+typedef struct sw_ev_fswatch_pending /* one coalesced (wd, name) pair */
+{
+    int      wd;
+    int      events;
+    unsigned hash;
+    unsigned name_offset; /* offset in name arena, (unsigned)-1 means no name */
+} sw_ev_fswatch_pending_t;
+
+struct sw_ev_fswatch
+{
+    sw_ev_context_t * ctx;
+    void (*callback)(int wd, const char *path, const char *name, int events, void *arg);
+    void *arg;
+    int   inotify_fd;
+    int   dispatching;
+    int   freed;
+    /* wd -> path, chained hash table */
+    sw_ev_fswatch_entry_t ** buckets;
+    unsigned buckets_count;
+    unsigned entries_count;
+    /* coalescing buffer, reused between drains */
+    sw_ev_fswatch_pending_t * pendings;
+    unsigned pendings_count;
+    unsigned pendings_capacity;
+    int    * index;          /* open addressing, value is index of pendings or -1 */
+    unsigned index_capacity; /* power of 2 */
+    char   * names;
+    unsigned names_size;
+    unsigned names_capacity;
+};
+
+static const struct
+{
+    int sw_event;
+    uint32_t in_event;
+} sw_ev_fswatch_map_[] =
+{
+    { SW_EV_FS_MODIFY,      IN_MODIFY },
+    { SW_EV_FS_ATTRIB,      IN_ATTRIB },
+    { SW_EV_FS_CLOSE_WRITE, IN_CLOSE_WRITE },
+    { SW_EV_FS_CREATE,      IN_CREATE },
+    { SW_EV_FS_DELETE,      IN_DELETE },
+    { SW_EV_FS_MOVED_FROM,  IN_MOVED_FROM },
+    { SW_EV_FS_MOVED_TO,    IN_MOVED_TO },
+    { SW_EV_FS_DELETE_SELF, IN_DELETE_SELF },
+    { SW_EV_FS_MOVE_SELF,   IN_MOVE_SELF },
+    { SW_EV_FS_ISDIR,       IN_ISDIR },
+    { SW_EV_FS_REMOVED,     IN_IGNORED },
+    { SW_EV_FS_OVERFLOW,    IN_Q_OVERFLOW },
+};
+
+static uint32_t
+sw_ev_fswatch_to_mask_(int what_events)
+{
+    uint32_t mask = 0;
+    unsigned i;
+    for (i = 0; i < sizeof(sw_ev_fswatch_map_)/sizeof(sw_ev_fswatch_map_[0]); ++i)
+    {
+        if (what_events & sw_ev_fswatch_map_[i].sw_event & SW_EV_FS_ALL)
+        {
+            mask |= sw_ev_fswatch_map_[i].in_event;
+        }
+    }
+    return mask;
+}
+
+static int
+sw_ev_fswatch_from_mask_(uint32_t mask)
+{
+    int events = 0;
+    unsigned i;
+    for (i = 0; i < sizeof(sw_ev_fswatch_map_)/sizeof(sw_ev_fswatch_map_[0]); ++i)
+    {
+        if (mask & sw_ev_fswatch_map_[i].in_event)
+        {
+            events |= sw_ev_fswatch_map_[i].sw_event;
+        }
+    }
+    return events;
+}
+
+static sw_ev_fswatch_entry_t **
+sw_ev_fswatch_find_(sw_ev_fswatch_t *watcher, int wd)
+{
+    sw_ev_fswatch_entry_t **pp = &watcher->buckets[(unsigned)wd & (watcher->buckets_count - 1)];
+    while (NULL != *pp && (*pp)->wd != wd)
+    {
+        pp = &(*pp)->next;
+    }
+    return pp;
+}
+
+static int
+sw_ev_fswatch_rehash_(sw_ev_fswatch_t *watcher, unsigned buckets_count)
+{
+    sw_ev_fswatch_entry_t **buckets;
+    sw_ev_fswatch_entry_t *entry, *next;
+    unsigned i;
+    buckets = (sw_ev_fswatch_entry_t **)sw_ev_malloc(buckets_count * sizeof(sw_ev_fswatch_entry_t *));
+    if (NULL == buckets)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(buckets, 0, buckets_count * sizeof(sw_ev_fswatch_entry_t *));
+    for (i = 0; i < watcher->buckets_count; ++i)
+    {
+        for (entry = watcher->buckets[i]; NULL != entry; entry = next)
+        {
+            next = entry->next;
+            entry->next = buckets[(unsigned)entry->wd & (buckets_count - 1)];
+            buckets[(unsigned)entry->wd & (buckets_count - 1)] = entry;
+        }
+    }
+    sw_ev_free(watcher->buckets);
+    watcher->buckets = buckets;
+    watcher->buckets_count = buckets_count;
+    return 0;
+}
+
+static void
+sw_ev_fswatch_remove_entry_(sw_ev_fswatch_t *watcher, int wd)
+{
+    sw_ev_fswatch_entry_t **pp = sw_ev_fswatch_find_(watcher, wd);
+    sw_ev_fswatch_entry_t *entry = *pp;
+    if (NULL != entry)
+    {
+        *pp = entry->next;
+        sw_ev_free(entry->path);
+        sw_ev_free(entry);
+        --watcher->entries_count;
+    }
+}
+
+static unsigned
+sw_ev_fswatch_hash_(int wd, const char *name)
+{
+    unsigned hash = 2166136261u ^ (unsigned)wd; /* FNV-1a */
+    if (NULL != name)
+    {
+        for (; *name; ++name)
+        {
+            hash = (hash ^ (unsigned char)*name) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static int
+sw_ev_fswatch_grow_index_(sw_ev_fswatch_t *watcher)
+{
+    unsigned capacity = watcher->index_capacity ? watcher->index_capacity * 2 : 64;
+    unsigned i, slot;
+    int *index = (int *)sw_ev_realloc(watcher->index, capacity * sizeof(int));
+    if (NULL == index)
+    {
+        sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(index, 0xff, capacity * sizeof(int));
+    for (i = 0; i < watcher->pendings_count; ++i)
+    {
+        slot = watcher->pendings[i].hash & (capacity - 1);
+        while (-1 != index[slot])
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        index[slot] = (int)i;
+    }
+    watcher->index = index;
+    watcher->index_capacity = capacity;
+    return 0;
+}
+
+/*
+ * Merge one kernel event into the pending table.
+ */
+static int
+sw_ev_fswatch_coalesce_(sw_ev_fswatch_t *watcher, int wd, const char *name, int events)
+{
+    unsigned hash = sw_ev_fswatch_hash_(wd, name);
+    unsigned slot;
+    size_t name_len = 0;
+    sw_ev_fswatch_pending_t *pending;
+    if ((watcher->pendings_count + 1) * 2 > watcher->index_capacity)
+    {
+        if (-1 == sw_ev_fswatch_grow_index_(watcher))
+        {
+            return -1;
+        }
+    }
+    slot = hash & (watcher->index_capacity - 1);
+    while (-1 != watcher->index[slot])
+    {
+        pending = &watcher->pendings[watcher->index[slot]];
+        if (pending->hash == hash && pending->wd == wd)
+        {
+            if ((NULL == name && (unsigned)-1 == pending->name_offset)
+                || (NULL != name && (unsigned)-1 != pending->name_offset
+                    && 0 == strcmp(name, watcher->names + pending->name_offset)))
+            {
+                pending->events |= events;
+                return 0;
+            }
+        }
+        slot = (slot + 1) & (watcher->index_capacity - 1);
+    }
+    if (watcher->pendings_count == watcher->pendings_capacity)
+    {
+        unsigned capacity = watcher->pendings_capacity ? watcher->pendings_capacity * 2 : 32;
+        pending = (sw_ev_fswatch_pending_t *)sw_ev_realloc(watcher->pendings,
+                                                           capacity * sizeof(sw_ev_fswatch_pending_t));
+        if (NULL == pending)
+        {
+            sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+            return -1;
+        }
+        watcher->pendings = pending;
+        watcher->pendings_capacity = capacity;
+    }
+    pending = &watcher->pendings[watcher->pendings_count];
+    pending->wd = wd;
+    pending->events = events;
+    pending->hash = hash;
+    pending->name_offset = (unsigned)-1;
+    if (NULL != name)
+    {
+        name_len = strlen(name) + 1;
+        if (watcher->names_size + name_len > watcher->names_capacity)
+        {
+            unsigned capacity = watcher->names_capacity ? watcher->names_capacity : 1024;
+            char *names;
+            while (capacity < watcher->names_size + name_len)
+            {
+                capacity <<= 1;
+            }
+            names = (char *)sw_ev_realloc(watcher->names, capacity);
+            if (NULL == names)
+            {
+                sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+                return -1;
+            }
+            watcher->names = names;
+            watcher->names_capacity = capacity;
+        }
+        memcpy(watcher->names + watcher->names_size, name, name_len);
+        pending->name_offset = watcher->names_size;
+        watcher->names_size += (unsigned)name_len;
+    }
+    watcher->index[slot] = (int)watcher->pendings_count++;
+    return 0;
+}
+
+static void
+sw_ev_fswatch_destroy_(sw_ev_fswatch_t *watcher)
+{
+    unsigned i;
+    sw_ev_fswatch_entry_t *entry, *next;
+    if (-1 != watcher->inotify_fd)
+    {
+        sw_ev_io_del(watcher->ctx, watcher->inotify_fd, SW_EV_READ);
+        close(watcher->inotify_fd); /* all watches are removed with the fd */
+    }
+    for (i = 0; i < watcher->buckets_count; ++i)
+    {
+        for (entry = watcher->buckets[i]; NULL != entry; entry = next)
+        {
+            next = entry->next;
+            sw_ev_free(entry->path);
+            sw_ev_free(entry);
+        }
+    }
+    sw_ev_free(watcher->buckets);
+    sw_ev_free(watcher->pendings);
+    sw_ev_free(watcher->index);
+    sw_ev_free(watcher->names);
+    sw_ev_free(watcher);
+}
+
+/*
+ * Call back for one event, with watcher->dispatching set by the caller.
+ */
+static void
+sw_ev_fswatch_deliver_(sw_ev_fswatch_t *watcher, int wd, const char *name, int events)
+{
+    sw_ev_fswatch_entry_t *entry;
+    if (-1 == wd)
+    {
+        watcher->callback(-1, NULL, NULL, events, watcher->arg);
+        return;
+    }
+    entry = *sw_ev_fswatch_find_(watcher, wd);
+    if (NULL == entry)
+    {
+        return; /* removed by sw_ev_fswatch_del() in previous callback */
+    }
+    watcher->callback(wd, entry->path, name, events, watcher->arg);
+    if ((events & SW_EV_FS_REMOVED) && !watcher->freed)
+    {
+        sw_ev_fswatch_remove_entry_(watcher, wd);
+    }
+}
+
+static void
+sw_ev_fswatch_dispatch_(sw_ev_fswatch_t *watcher)
+{
+    unsigned i;
+    sw_ev_fswatch_pending_t *pending;
+    watcher->dispatching = 1;
+    for (i = 0; i < watcher->pendings_count && !watcher->freed; ++i)
+    {
+        pending = &watcher->pendings[i];
+        sw_ev_fswatch_deliver_(watcher, pending->wd,
+                               (unsigned)-1 == pending->name_offset ? NULL : watcher->names + pending->name_offset,
+                               pending->events);
+    }
+    watcher->dispatching = 0;
+    watcher->pendings_count = 0;
+    watcher->names_size = 0;
+    if (watcher->index_capacity)
+    {
+        memset(watcher->index, 0xff, watcher->index_capacity * sizeof(int));
+    }
+    if (watcher->freed)
+    {
+        sw_ev_fswatch_destroy_(watcher);
+    }
+}
+
+static void
+sw_ev_fswatch_ready_(int fd, int events, void *arg)
+{
+    sw_ev_fswatch_t *watcher = (sw_ev_fswatch_t *)arg;
+    /* aligned for struct inotify_event */
+    char buf[8192] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *in_event;
+    ssize_t ret;
+    char *ptr;
+    while (1)
+    {
+        ret = read(fd, buf, sizeof(buf));
+        if (ret > 0)
+        {
+            for (ptr = buf; ptr < buf + ret; ptr += sizeof(struct inotify_event) + in_event->len)
+            {
+                in_event = (const struct inotify_event *)ptr;
+                if (-1 == sw_ev_fswatch_coalesce_(watcher, in_event->wd,
+                                                  in_event->len ? in_event->name : NULL,
+                                                  sw_ev_fswatch_from_mask_(in_event->mask)))
+                {
+                    /* out of memory, deliver it uncoalesced rather than drop it */
+                    watcher->dispatching = 1;
+                    sw_ev_fswatch_deliver_(watcher, in_event->wd,
+                                           in_event->len ? in_event->name : NULL,
+                                           sw_ev_fswatch_from_mask_(in_event->mask));
+                    watcher->dispatching = 0;
+                    if (watcher->freed)
+                    {
+                        sw_ev_fswatch_destroy_(watcher);
+                        return;
+                    }
+                }
+            }
+        }
+        else if (ret < 0)
+        {
+            if (SW_ERRNO == EINTR) continue;
+            else if (SW_ERRNO == EAGAIN) break;
+            else
+            {
+                sw_log_error("%s:%d read: %d", __FILE__, __LINE__, SW_ERRNO);
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    sw_ev_fswatch_dispatch_(watcher);
+}
+
+sw_ev_fswatch_t *
+sw_ev_fswatch_new(sw_ev_context_t *ctx,
+                  void (*callback)(int wd, const char *path, const char *name,
+                                   int events, void *arg),
+                  void *arg)
+{
+    sw_ev_fswatch_t *watcher;
+    if (NULL == ctx || NULL == callback)
+    {
+        return NULL;
+    }
+    watcher = (sw_ev_fswatch_t *)sw_ev_malloc(sizeof(sw_ev_fswatch_t));
+    if (NULL == watcher)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(watcher, 0, sizeof(sw_ev_fswatch_t));
+    watcher->ctx = ctx;
+    watcher->callback = callback;
+    watcher->arg = arg;
+    watcher->inotify_fd = -1;
+    if (-1 == sw_ev_fswatch_rehash_(watcher, 16))
+    {
+        goto oh_no;
+    }
+    watcher->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (-1 == watcher->inotify_fd)
+    {
+        sw_log_error("%s:%d inotify_init1: %d", __FILE__, __LINE__, SW_ERRNO);
+        goto oh_no;
+    }
+    if (-1 == sw_ev_io_add(ctx, watcher->inotify_fd, SW_EV_READ, sw_ev_fswatch_ready_, watcher))
+    {
+        sw_log_error("%s:%d sw_ev_io_add: %d", __FILE__, __LINE__, SW_ERRNO);
+        close(watcher->inotify_fd);
+        watcher->inotify_fd = -1;
+        goto oh_no;
+    }
+    return watcher;
+oh_no:
+    sw_ev_fswatch_destroy_(watcher);
+    return NULL;
+}
+
+void
+sw_ev_fswatch_free(sw_ev_fswatch_t *watcher)
+{
+    if (NULL != watcher)
+    {
+        if (watcher->dispatching)
+        {
+            watcher->freed = 1; /* destroyed after dispatching */
+            return;
+        }
+        sw_ev_fswatch_destroy_(watcher);
+    }
+}
+
+int
+sw_ev_fswatch_add(sw_ev_fswatch_t *watcher, const char *path, int what_events)
+{
+    uint32_t mask = sw_ev_fswatch_to_mask_(what_events);
+    sw_ev_fswatch_entry_t **pp;
+    sw_ev_fswatch_entry_t *entry;
+    size_t path_len;
+    int wd;
+    if (NULL == watcher || NULL == path || 0 == mask)
+    {
+        return -1;
+    }
+    wd = inotify_add_watch(watcher->inotify_fd, path, mask);
+    if (-1 == wd)
+    {
+        sw_log_error("%s:%d inotify_add_watch %s: %d", __FILE__, __LINE__, path, SW_ERRNO);
+        return -1;
+    }
+    pp = sw_ev_fswatch_find_(watcher, wd);
+    if (NULL != *pp)
+    {
+        return wd; /* same inode watched again, mask was replaced */
+    }
+    if (watcher->entries_count >= watcher->buckets_count)
+    {
+        if (-1 == sw_ev_fswatch_rehash_(watcher, watcher->buckets_count * 2))
+        {
+            goto oh_no;
+        }
+    }
+    entry = (sw_ev_fswatch_entry_t *)sw_ev_malloc(sizeof(sw_ev_fswatch_entry_t));
+    if (NULL == entry)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        goto oh_no;
+    }
+    path_len = strlen(path) + 1;
+    entry->path = (char *)sw_ev_malloc(path_len);
+    if (NULL == entry->path)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        sw_ev_free(entry);
+        goto oh_no;
+    }
+    memcpy(entry->path, path, path_len);
+    entry->wd = wd;
+    pp = &watcher->buckets[(unsigned)wd & (watcher->buckets_count - 1)];
+    entry->next = *pp;
+    *pp = entry;
+    ++watcher->entries_count;
+    return wd;
+oh_no:
+    inotify_rm_watch(watcher->inotify_fd, wd);
+    return -1;
+}
+
+int
+sw_ev_fswatch_del(sw_ev_fswatch_t *watcher, int wd)
+{
+    if (NULL == watcher || NULL == *sw_ev_fswatch_find_(watcher, wd))
+    {
+        return -1;
+    }
+    inotify_rm_watch(watcher->inotify_fd, wd);
+    /* The IN_IGNORED event generated by inotify_rm_watch() is dropped in dispatching,
+     * because the entry can't be found any more. */
+    sw_ev_fswatch_remove_entry_(watcher, wd);
+    return 0;
+}
+
+#else /* not linux */
+
+sw_ev_fswatch_t *
+sw_ev_fswatch_new(sw_ev_context_t *ctx,
+                  void (*callback)(int wd, const char *path, const char *name,
+                                   int events, void *arg),
+                  void *arg)
+{
+    sw_log_error("%s:%d sw_ev_fswatch_new: not support current operating system yet.",
+                 __FILE__, __LINE__);
+    return NULL;
+}
+
+void
+sw_ev_fswatch_free(sw_ev_fswatch_t *watcher)
+{
+}
+
+int
+sw_ev_fswatch_add(sw_ev_fswatch_t *watcher, const char *path, int what_events)
+{
+    return -1;
+}
+
+int
+sw_ev_fswatch_del(sw_ev_fswatch_t *watcher, int wd)
+{
+    return -1;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,101 @@
+/**
+ * File system change watcher for libswevent.
+ * The watcher owns one inotify fd which is registered to the sw_ev_context
+ * with sw_ev_io_add(). All pending kernel events are drained when the fd becomes
+ * readable, events for the same (watch, name) pair are coalesced into one bits-or
+ * value, then delivered to the callback once per pair. An event that can't be
+ * coalesced for lack of memory is delivered alone at once.
+ * Currently supporting platform: linux(use inotify). On other platforms
+ * sw_ev_fswatch_new() always fails.
+ */
+#ifndef INC_SW_FSWATCH_H
+#define INC_SW_FSWATCH_H
+
+#include "sw_event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+enum /* file system event type */
+{
+    SW_EV_FS_MODIFY      = 0x0001, /* file content was modified */
+    SW_EV_FS_ATTRIB      = 0x0002, /* metadata changed (permission, timestamps, link count...) */
+    SW_EV_FS_CLOSE_WRITE = 0x0004, /* file opened for writing was closed */
+    SW_EV_FS_CREATE      = 0x0008, /* file or directory created in watched directory */
+    SW_EV_FS_DELETE      = 0x0010, /* file or directory deleted from watched directory */
+    SW_EV_FS_MOVED_FROM  = 0x0020, /* file moved out of watched directory */
+    SW_EV_FS_MOVED_TO    = 0x0040, /* file moved into watched directory */
+    SW_EV_FS_DELETE_SELF = 0x0080, /* watched path itself was deleted */
+    SW_EV_FS_MOVE_SELF   = 0x0100, /* watched path itself was moved */
+    SW_EV_FS_ALL         = 0x01ff,
+
+    /* The following bits are only reported, you needn't to register them. */
+    SW_EV_FS_ISDIR       = 0x1000, /* the subject of the event is a directory */
+    SW_EV_FS_REMOVED     = 0x2000, /* watch was removed, the wd is invalid after callback */
+    SW_EV_FS_OVERFLOW    = 0x4000, /* kernel event queue overflowed, events were lost */
+};
+
+typedef struct sw_ev_fswatch sw_ev_fswatch_t;
+
+/**
+ * Create a file system watcher and register it to ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          callback - It will be called once for every changed (wd, name) pair after
+ *          all pending events were drained. callback's first argument is the watch
+ *          descriptor returned by sw_ev_fswatch_add(), second argument is the watched path,
+ *          third argument is the name of the changed entry inside a watched directory
+ *          (NULL when the event is about the watched path itself), fourth argument is the
+ *          bits or of coalesced SW_EV_FS_* events, the last argument is the user data
+ *          pointer. When the kernel queue overflowed, callback is called with wd -1,
+ *          path NULL and SW_EV_FS_OVERFLOW, you should rescan the watched paths.
+ *          arg - user data pointer.
+ * return:  not NULL success, NULL failed.
+ * note:    You must use sw_ev_fswatch_free() to release the watcher.
+ */
+sw_ev_fswatch_t *
+sw_ev_fswatch_new(sw_ev_context_t *ctx,
+                  void (*callback)(int wd, const char *path, const char *name,
+                                   int events, void *arg),
+                  void *arg);
+
+/**
+ * Remove all watches, unregister the watcher from its context and free it.
+ * It is safe to call it in the watcher's callback.
+ */
+void sw_ev_fswatch_free(sw_ev_fswatch_t *watcher);
+
+/**
+ * Start watching a file or directory.
+ * param:   watcher - watcher returned by sw_ev_fswatch_new().
+ *          path - file or directory path.
+ *          what_events - The bits or of SW_EV_FS_* events.
+ * return:  watch descriptor (>= 0) success, -1 failed.
+ * note:    Adding the same path again replaces its event mask and returns the same wd.
+ *          To follow a config file which is replaced by rename(), watch its directory
+ *          with SW_EV_FS_CLOSE_WRITE | SW_EV_FS_MOVED_TO and filter the name.
+ */
+int  sw_ev_fswatch_add(sw_ev_fswatch_t *watcher, const char *path, int what_events);
+
+/**
+ * Stop watching.
+ * param:   watcher - watcher returned by sw_ev_fswatch_new().
+ *          wd - watch descriptor returned by sw_ev_fswatch_add().
+ * return:  0 success, -1 failed.
+ */
+int  sw_ev_fswatch_del(sw_ev_fswatch_t *watcher, int wd);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,401 @@
+#include "sw_event_internal.h"
+#ifdef SW_EV_IO_URING
+#include "sw_log.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef POLLRDHUP
+#define POLLRDHUP 0x2000
+#endif
+
+/*
+ * io_uring backend without liburing, fds are watched by multishot poll requests, they
+ * post a completion on every wake up of the fd like epoll's edge triggered mode.
+ * Interest changes in the loop are queued in the submission ring and submitted by next
+ * poll-wait, or when sw_ev_loop_run() returns, so they cost no syscall. Changes out of
+ * the loop are submitted at once. Requires linux 5.13.
+ */
+
+enum { SW_EV_URING_ENTRIES = 256 };
+
+#define SW_EV_URING_IGNORED  (~(uint64_t)0) /* user_data of requests without result */
+
+struct sw_ev_uring
+{
+    unsigned *              sq_head;
+    unsigned *              sq_tail;
+    unsigned *              sq_mask;
+    unsigned *              sq_array;
+    struct io_uring_sqe *   sqes;
+    unsigned *              cq_head;
+    unsigned *              cq_tail;
+    unsigned *              cq_mask;
+    struct io_uring_cqe *   cqes;
+    void *                  sq_ring;
+    size_t                  sq_ring_size;
+    void *                  cq_ring;
+    size_t                  cq_ring_size;
+    size_t                  sqes_size;
+    unsigned *              generations; /* per fd, tag of the armed poll request */
+    int                     generations_count;
+};
+
+#define SW_EV_URING_LOAD_ACQUIRE(ptr)          __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SW_EV_URING_STORE_RELEASE(ptr, value)  __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+static void
+uring_unmap_(struct sw_ev_uring *ring)
+{
+    if (NULL != ring->sqes)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (NULL != ring->cq_ring && ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (NULL != ring->sq_ring)
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+}
+
+static void
+uring_destroy_(sw_ev_context_t *ctx)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    if (NULL != ring)
+    {
+        uring_unmap_(ring);
+        sw_ev_free(ring->generations);
+        sw_ev_free(ring);
+        ctx->backend_data = NULL;
+    }
+    if (-1 != ctx->backend_fd)
+    {
+        close(ctx->backend_fd);
+        ctx->backend_fd = -1;
+    }
+}
+
+static int
+uring_init_(sw_ev_context_t *ctx)
+{
+    struct io_uring_params params;
+    struct sw_ev_uring *ring;
+    char *sq_ring, *cq_ring;
+    memset(&params, 0, sizeof(params));
+    ctx->backend_fd = (int)syscall(__NR_io_uring_setup, SW_EV_URING_ENTRIES, &params);
+    if (-1 == ctx->backend_fd)
+    {
+        sw_log_error("%s:%d io_uring_setup: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    /* multishot poll came with linux 5.13, together with IORING_FEAT_RSRC_TAGS */
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_RSRC_TAGS))
+    {
+        sw_log_error("%s:%d io_uring is too old, features: %x", __FILE__, __LINE__, params.features);
+        close(ctx->backend_fd);
+        ctx->backend_fd = -1;
+        return -1;
+    }
+    ring = (struct sw_ev_uring *)sw_ev_malloc(sizeof(struct sw_ev_uring));
+    if (NULL == ring)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        close(ctx->backend_fd);
+        ctx->backend_fd = -1;
+        return -1;
+    }
+    memset(ring, 0, sizeof(struct sw_ev_uring));
+    ctx->backend_data = ring;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ctx->backend_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ring->sq_ring)
+    {
+        ring->sq_ring = NULL;
+        goto oh_no;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ctx->backend_fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == ring->cq_ring)
+        {
+            ring->cq_ring = NULL;
+            goto oh_no;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, ctx->backend_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ring->sqes)
+    {
+        ring->sqes = NULL;
+        goto oh_no;
+    }
+    sq_ring = (char *)ring->sq_ring;
+    cq_ring = (char *)ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    return 0;
+oh_no:
+    sw_log_error("%s:%d mmap: %d", __FILE__, __LINE__, SW_ERRNO);
+    uring_destroy_(ctx);
+    return -1;
+}
+
+/*
+ * Submit queued requests, and wait for at least one completion if wait_time is not 0.
+ */
+static int
+uring_enter_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned to_submit = *ring->sq_tail - SW_EV_URING_LOAD_ACQUIRE(ring->sq_head);
+    int ret;
+    if (0 == wait_time)
+    {
+        if (0 == to_submit)
+        {
+            return 0;
+        }
+        ret = (int)syscall(__NR_io_uring_enter, ctx->backend_fd, to_submit, 0, 0, NULL, 0);
+    }
+    else
+    {
+        memset(&arg, 0, sizeof(arg));
+        if (wait_time > 0)
+        {
+            ts.tv_sec = wait_time / 1000;
+            ts.tv_nsec = wait_time % 1000 * 1000000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+        ret = (int)syscall(__NR_io_uring_enter, ctx->backend_fd, to_submit, 1,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    if (-1 == ret && SW_ERRNO != EINTR && SW_ERRNO != ETIME && SW_ERRNO != EBUSY)
+    {
+        sw_log_error("%s:%d io_uring_enter: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    return 0;
+}
+
+static struct io_uring_sqe *
+uring_get_sqe_(sw_ev_context_t *ctx)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    unsigned tail = *ring->sq_tail;
+    struct io_uring_sqe *sqe;
+    if (tail - SW_EV_URING_LOAD_ACQUIRE(ring->sq_head) > *ring->sq_mask)
+    {
+        /* submission ring is full */
+        if (-1 == uring_enter_(ctx, 0) || tail - SW_EV_URING_LOAD_ACQUIRE(ring->sq_head) > *ring->sq_mask)
+        {
+            return NULL;
+        }
+    }
+    sqe = &ring->sqes[tail & *ring->sq_mask];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[tail & *ring->sq_mask] = tail & *ring->sq_mask;
+    SW_EV_URING_STORE_RELEASE(ring->sq_tail, tail + 1);
+    return sqe;
+}
+
+static int
+uring_arm_(sw_ev_context_t *ctx, int fd, int what_events)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    struct io_uring_sqe *sqe = uring_get_sqe_(ctx);
+    unsigned poll_events = POLLPRI | POLLERR | POLLHUP | POLLRDHUP;
+    if (NULL == sqe)
+    {
+        sw_log_error("%s:%d io_uring submission ring is full", __FILE__, __LINE__);
+        return -1;
+    }
+    if (what_events & SW_EV_READ)
+    {
+        poll_events |= POLLIN;
+    }
+    if (what_events & SW_EV_WRITE)
+    {
+        poll_events |= POLLOUT;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    poll_events = (poll_events << 16) | (poll_events >> 16);
+#endif
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = poll_events;
+    sqe->user_data = ((uint64_t)ring->generations[fd] << 32) | (unsigned)fd;
+    return 0;
+}
+
+static int
+uring_update_(sw_ev_context_t *ctx, int fd, int old_events, int new_events)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    if (fd >= ring->generations_count)
+    {
+        int count = ring->generations_count ? ring->generations_count : 1024;
+        unsigned *generations;
+        while (count <= fd)
+        {
+            count <<= 1;
+        }
+        generations = (unsigned *)sw_ev_realloc(ring->generations, count * sizeof(unsigned));
+        if (NULL == generations)
+        {
+            sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+            return -1;
+        }
+        memset(generations + ring->generations_count, 0,
+               (count - ring->generations_count) * sizeof(unsigned));
+        ring->generations = generations;
+        ring->generations_count = count;
+    }
+    if (old_events)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe_(ctx);
+        if (NULL == sqe)
+        {
+            sw_log_error("%s:%d io_uring submission ring is full", __FILE__, __LINE__);
+            return -1;
+        }
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = ((uint64_t)ring->generations[fd] << 32) | (unsigned)fd;
+        sqe->user_data = SW_EV_URING_IGNORED;
+    }
+    /* completions of the removed request are recognized by the old generation */
+    ++ring->generations[fd];
+    if (new_events && -1 == uring_arm_(ctx, fd, new_events))
+    {
+        return -1;
+    }
+    /* out of the loop nothing else submits, e.g. for a host loop watching the ring fd */
+    return ctx->in_loop ? 0 : uring_enter_(ctx, 0);
+}
+
+static int
+uring_flush_(sw_ev_context_t *ctx)
+{
+    return uring_enter_(ctx, 0);
+}
+
+static int
+uring_poll_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct sw_ev_uring *ring = (struct sw_ev_uring *)ctx->backend_data;
+    int nfds = 0;
+    int ret;
+    unsigned head;
+    int64_t poll_begin_time;
+    if (*ring->cq_head != SW_EV_URING_LOAD_ACQUIRE(ring->cq_tail))
+    {
+        wait_time = 0;
+    }
+    poll_begin_time = sw_ev_stats_poll_begin_(ctx);
+    ret = uring_enter_(ctx, wait_time);
+    head = *ring->cq_head;
+    nfds = (int)(SW_EV_URING_LOAD_ACQUIRE(ring->cq_tail) - head);
+    sw_ev_stats_poll_end_(ctx, poll_begin_time, nfds);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_POLL, poll_end, nfds);
+    if (-1 == ret)
+    {
+        return -1;
+    }
+    /* callbacks only queue submissions, so completions are consumed one by one in place */
+    while (head != SW_EV_URING_LOAD_ACQUIRE(ring->cq_tail))
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        int fd = (int)(unsigned)user_data;
+        int what_events = 0;
+        SW_EV_URING_STORE_RELEASE(ring->cq_head, ++head);
+        if (SW_EV_URING_IGNORED == user_data || fd >= ring->generations_count
+            || (unsigned)(user_data >> 32) != ring->generations[fd])
+        {
+            continue;
+        }
+        if (!(flags & IORING_CQE_F_MORE) && fd < ctx->io_events_count && ctx->io_events[fd].events)
+        {
+            /* multishot request terminated, by completion ring overflow if res >= 0 */
+            ++ring->generations[fd];
+            if (res < 0 || -1 == uring_arm_(ctx, fd, ctx->io_events[fd].events))
+            {
+                /* arming again after an error could fail forever, so report it instead,
+                 * the fd is watched again by next sw_ev_io_add() */
+                sw_log_error("%s:%d io_uring poll of fd %d terminated: %d", __FILE__, __LINE__,
+                             fd, res < 0 ? -res : SW_ERRNO);
+                sw_ev_io_dispatch_(ctx, fd, ctx->io_events[fd].events | SW_EV_ERROR);
+                continue;
+            }
+        }
+        if (res <= 0)
+        {
+            continue;
+        }
+        if (res & (POLLIN | POLLPRI | POLLERR | POLLHUP | POLLRDHUP))
+        {
+            what_events |= SW_EV_READ;
+        }
+        if (res & (POLLHUP | POLLRDHUP))
+        {
+            what_events |= SW_EV_CLOSED;
+        }
+        if (res & POLLERR)
+        {
+            what_events |= SW_EV_ERROR;
+        }
+        if (res & POLLPRI)
+        {
+            what_events |= SW_EV_PRI;
+        }
+        if (res & POLLOUT)
+        {
+            what_events |= SW_EV_WRITE;
+        }
+        sw_ev_io_dispatch_(ctx, fd, what_events);
+    }
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_IO, io_end, nfds);
+    return 0;
+}
+
+const sw_ev_backend_t sw_ev_backend_io_uring_ =
+{
+    "io_uring", uring_init_, uring_destroy_, uring_update_, uring_poll_, uring_flush_
+};
+
+#endif /* SW_EV_IO_URING */
@@ -0,0 +1,130 @@
+#include "sw_event_internal.h"
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include "sw_log.h"
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+
+/*
+ * kqueue backend for FreeBSD and MAC.
+ */
+
+static int
+kqueue_init_(sw_ev_context_t *ctx)
+{
+    ctx->backend_fd = kqueue();
+    if (-1 == ctx->backend_fd)
+    {
+        sw_log_error("%s:%d kqueue: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    return 0;
+}
+
+static void
+kqueue_destroy_(sw_ev_context_t *ctx)
+{
+    if (-1 != ctx->backend_fd)
+    {
+        close(ctx->backend_fd);
+        ctx->backend_fd = -1;
+    }
+}
+
+static int
+kqueue_update_(sw_ev_context_t *ctx, int fd, int old_events, int new_events)
+{
+    struct kevent kev;
+    if (new_events & SW_EV_READ)
+    {
+        EV_SET(&kev, fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+        if (-1 == kevent(ctx->backend_fd, &kev, 1, NULL, 0, NULL))
+        {
+            sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
+            return -1;
+        }
+    }
+    else if (old_events & SW_EV_READ)
+    {
+        EV_SET(&kev, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+        kevent(ctx->backend_fd, &kev, 1, NULL, 0, NULL);
+    }
+    if (new_events & SW_EV_WRITE)
+    {
+        EV_SET(&kev, fd, EVFILT_WRITE, EV_ADD, 0, 0, NULL);
+        if (-1 == kevent(ctx->backend_fd, &kev, 1, NULL, 0, NULL))
+        {
+            sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
+            return -1;
+        }
+    }
+    else if (old_events & SW_EV_WRITE)
+    {
+        EV_SET(&kev, fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+        kevent(ctx->backend_fd, &kev, 1, NULL, 0, NULL);
+    }
+    return 0;
+}
+
+static int
+kqueue_poll_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct kevent ready_events[1024];
+    int nfds = 0;
+    int i = 0;
+    struct timespec timeout;
+    int64_t poll_begin_time;
+
+    timeout.tv_sec = wait_time / 1000;
+    timeout.tv_nsec = wait_time % 1000 * 1000000;
+    poll_begin_time = sw_ev_stats_poll_begin_(ctx);
+    nfds = kevent(ctx->backend_fd, NULL, 0, ready_events, sizeof(ready_events)/sizeof(struct kevent),
+                  wait_time < 0 ? NULL : &timeout);
+    sw_ev_stats_poll_end_(ctx, poll_begin_time, nfds);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_POLL, poll_end, nfds);
+    if (nfds == -1)
+    {
+        if (SW_ERRNO != EINTR)
+        {
+            sw_log_error("%s:%d kevent: %d", __FILE__, __LINE__, SW_ERRNO);
+            return -1;
+        }
+    }
+    for (i = 0; i < nfds; i++)
+    {
+        int what_events = 0;
+        if (ready_events[i].filter == EVFILT_READ)
+        {
+            what_events |= SW_EV_READ;
+        }
+        if (ready_events[i].filter == EVFILT_WRITE)
+        {
+            what_events |= SW_EV_WRITE;
+        }
+        if (ready_events[i].flags & EV_EOF)
+        {
+            /* fflags holds the socket error if any */
+            what_events |= SW_EV_READ | SW_EV_CLOSED;
+            if (0 != ready_events[i].fflags)
+            {
+                what_events |= SW_EV_ERROR;
+            }
+        }
+        if (ready_events[i].flags & EV_ERROR)
+        {
+            what_events |= SW_EV_READ | SW_EV_ERROR;
+        }
+        sw_ev_io_dispatch_(ctx, (int)ready_events[i].ident, what_events);
+    }
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_IO, io_end, nfds);
+    return 0;
+}
+
+const sw_ev_backend_t sw_ev_backend_kqueue_ =
+{
+    "kqueue", kqueue_init_, kqueue_destroy_, kqueue_update_, kqueue_poll_, NULL
+};
+
+#endif /* __APPLE__ || __FreeBSD__ */
@@ -2,32 +2,723 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
-#include "sw_event.h"
+#include "sw_event_internal.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
 
 extern sw_log_func_t log_func;
+extern int log_level;
+
+/*
+ * Asynchronous logging. Every logging thread owns a single producer single consumer
+ * ring of records, a record keeps the format pointer and the binary arguments, the
+ * flusher thread formats it later and calls log_func. Formats must be string
+ * literals, which is true for the sw_log_* calls in libswevent.
+ */
+enum
+{
+    SW_LOG_RING_SIZE = 64 * 1024, /* default bytes of a thread's ring */
+    SW_LOG_ARGS_MAX = 1024,       /* max bytes of a record's arguments, strings are truncated */
+    SW_LOG_FLUSH_INTERVAL = 10,   /* ms, flusher sleeps when all rings are empty */
+    SW_LOG_PADDING = -1,          /* level of the record padding to the ring end */
+};
+
+typedef struct sw_log_record
+{
+    uint32_t     size;      /* bytes of the whole record, 8 aligned */
+    int32_t      level;
+    uint32_t     args_size; /* bytes of arguments following the record */
+    uint32_t     reserved;
+    const char * fmt;
+} sw_log_record_t;
+
+typedef struct sw_log_ring
+{
+    unsigned char *   buf;
+    uint32_t          capacity;      /* power of 2 */
+    volatile uint64_t head;          /* bytes ever written, by the owner thread */
+    char              pad1[64];      /* keep head and tail in different cache lines */
+    volatile uint64_t tail;          /* bytes ever consumed, by the flusher */
+    volatile uint64_t dropped;       /* records dropped because the ring is full */
+    uint64_t          dropped_reported;
+    volatile int      closed;        /* owner thread exited or left it for a newer generation */
+    struct sw_log_ring * next;
+} sw_log_ring_t;
+
+#ifdef _WIN32
+static CRITICAL_SECTION sw_log_lock_;
+static volatile LONG sw_log_lock_inited_ = 0;
+static HANDLE sw_log_flusher_;
+#else
+static pthread_mutex_t sw_log_lock_ = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t sw_log_key_once_ = PTHREAD_ONCE_INIT;
+static pthread_key_t sw_log_key_;
+static pthread_t sw_log_flusher_;
+#endif
+
+static sw_log_ring_t * volatile sw_log_rings_ = NULL; /* pushed at head under sw_log_lock_ */
+static volatile int sw_log_async_running_ = 0;
+static volatile int sw_log_async_stopping_ = 0;
+static volatile unsigned sw_log_generation_ = 0; /* increased by every sw_log_async_start() */
+static uint32_t sw_log_ring_size_ = SW_LOG_RING_SIZE;
+static SW_EV_THREAD_LOCAL sw_log_ring_t * sw_log_thread_ring_ = NULL;
+static SW_EV_THREAD_LOCAL unsigned sw_log_thread_generation_ = 0;
+
+static void
+sw_log_lock_acquire_()
+{
+#ifdef _WIN32
+    if (0 == InterlockedCompareExchange(&sw_log_lock_inited_, 1, 0))
+    {
+        InitializeCriticalSection(&sw_log_lock_);
+        InterlockedExchange(&sw_log_lock_inited_, 2);
+    }
+    while (2 != sw_log_lock_inited_)
+    {
+        Sleep(0);
+    }
+    EnterCriticalSection(&sw_log_lock_);
+#else
+    pthread_mutex_lock(&sw_log_lock_);
+#endif
+}
+
+static void
+sw_log_lock_release_()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&sw_log_lock_);
+#else
+    pthread_mutex_unlock(&sw_log_lock_);
+#endif
+}
+
+/*
+ * A conversion specification of format, from '%' to the conversion character.
+ */
+typedef struct sw_log_spec
+{
+    const char * begin;      /* at '%' */
+    const char * length_pos; /* end of flags, width and precision */
+    int          stars;      /* count of '*' width and precision */
+    int          precision;  /* -1 none, -2 given by the last '*' argument */
+    char         length;     /* 'H' hh, 'h', 'l', 'q' ll, 'z', 'j', 't', 'L', 0 for none */
+    char         conv;       /* 0 if unsupported */
+} sw_log_spec_t;
+
+/*
+ * Parse the specification at p, which points to '%', and return the end of it.
+ */
+static const char *
+sw_log_parse_spec_(const char *p, sw_log_spec_t *spec)
+{
+    spec->begin = p++;
+    spec->stars = 0;
+    spec->precision = -1;
+    spec->length = 0;
+    while ('-' == *p || '+' == *p || ' ' == *p || '#' == *p || '0' == *p)
+    {
+        ++p;
+    }
+    if ('*' == *p)
+    {
+        ++spec->stars;
+        ++p;
+    }
+    while (*p >= '0' && *p <= '9')
+    {
+        ++p;
+    }
+    if ('.' == *p)
+    {
+        ++p;
+        spec->precision = 0;
+        if ('*' == *p)
+        {
+            ++spec->stars;
+            spec->precision = -2;
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            spec->precision = spec->precision * 10 + (*p - '0');
+            ++p;
+        }
+    }
+    spec->length_pos = p;
+    if ('h' == *p || 'l' == *p)
+    {
+        spec->length = *p++;
+        if (spec->length == *p)
+        {
+            spec->length = 'h' == *p ? 'H' : 'q';
+            ++p;
+        }
+    }
+    else if ('z' == *p || 'j' == *p || 't' == *p || 'L' == *p)
+    {
+        spec->length = *p++;
+    }
+    spec->conv = 0;
+    if ('\0' != *p && NULL != strchr("diouxXcsfFeEgGaApn%", *p))
+    {
+        spec->conv = *p++;
+    }
+    if (('s' == spec->conv || 'c' == spec->conv) && 'l' == spec->length)
+    {
+        spec->conv = 0; /* wide characters */
+    }
+    return p;
+}
+
+static int
+sw_log_put_(unsigned char *args, uint32_t *args_size, const void *value, uint32_t size)
+{
+    if (*args_size + size > SW_LOG_ARGS_MAX)
+    {
+        return -1;
+    }
+    memcpy(args + *args_size, value, size);
+    *args_size += size;
+    return 0;
+}
+
+/*
+ * Capture the arguments of fmt in binary, return -1 at the first one not fit.
+ */
+static int
+sw_log_capture_(const char *fmt, va_list ap, unsigned char *args, uint32_t *args_size)
+{
+    sw_log_spec_t spec;
+    const char *p = fmt;
+    long long star = -1;
+    int i;
+    while (NULL != (p = strchr(p, '%')))
+    {
+        p = sw_log_parse_spec_(p, &spec);
+        if (0 == spec.conv)
+        {
+            return 0;
+        }
+        for (i = 0; i < spec.stars; ++i)
+        {
+            star = va_arg(ap, int);
+            if (-1 == sw_log_put_(args, args_size, &star, sizeof(star)))
+            {
+                return -1;
+            }
+        }
+        if (-2 == spec.precision)
+        {
+            spec.precision = star < 0 ? -1 : (int)star; /* negative precision is taken as none */
+        }
+        if (NULL != strchr("di", spec.conv) || 'c' == spec.conv)
+        {
+            long long value;
+            switch (spec.length)
+            {
+            case 'H': value = (signed char)va_arg(ap, int); break;
+            case 'h': value = (short)va_arg(ap, int); break;
+            case 'l': value = va_arg(ap, long); break;
+            case 'q': value = va_arg(ap, long long); break;
+            case 'z': value = (long long)va_arg(ap, size_t); break;
+            case 'j': value = va_arg(ap, intmax_t); break;
+            case 't': value = va_arg(ap, ptrdiff_t); break;
+            default:  value = va_arg(ap, int); break;
+            }
+            if (-1 == sw_log_put_(args, args_size, &value, sizeof(value)))
+            {
+                return -1;
+            }
+        }
+        else if (NULL != strchr("ouxX", spec.conv))
+        {
+            unsigned long long value;
+            switch (spec.length)
+            {
+            case 'H': value = (unsigned char)va_arg(ap, unsigned); break;
+            case 'h': value = (unsigned short)va_arg(ap, unsigned); break;
+            case 'l': value = va_arg(ap, unsigned long); break;
+            case 'q': value = va_arg(ap, unsigned long long); break;
+            case 'z': value = va_arg(ap, size_t); break;
+            case 'j': value = va_arg(ap, uintmax_t); break;
+            case 't': value = (unsigned long long)va_arg(ap, ptrdiff_t); break;
+            default:  value = va_arg(ap, unsigned); break;
+            }
+            if (-1 == sw_log_put_(args, args_size, &value, sizeof(value)))
+            {
+                return -1;
+            }
+        }
+        else if (NULL != strchr("fFeEgGaA", spec.conv))
+        {
+            if ('L' == spec.length)
+            {
+                long double value = va_arg(ap, long double);
+                if (-1 == sw_log_put_(args, args_size, &value, sizeof(value)))
+                {
+                    return -1;
+                }
+            }
+            else
+            {
+                double value = va_arg(ap, double);
+                if (-1 == sw_log_put_(args, args_size, &value, sizeof(value)))
+                {
+                    return -1;
+                }
+            }
+        }
+        else if ('p' == spec.conv || 'n' == spec.conv)
+        {
+            void *value = va_arg(ap, void *);
+            if ('p' == spec.conv && -1 == sw_log_put_(args, args_size, &value, sizeof(value)))
+            {
+                return -1;
+            }
+        }
+        else if ('s' == spec.conv)
+        {
+            const char *value = va_arg(ap, const char *);
+            uint32_t len;
+            if (NULL == value)
+            {
+                value = "(null)";
+            }
+            /* with a precision the string may not be NUL terminated */
+            len = (uint32_t)(spec.precision >= 0 ? strnlen(value, spec.precision) : strlen(value));
+            if (*args_size + sizeof(len) + 1 > SW_LOG_ARGS_MAX)
+            {
+                return -1;
+            }
+            if (*args_size + sizeof(len) + len + 1 > SW_LOG_ARGS_MAX)
+            {
+                len = SW_LOG_ARGS_MAX - *args_size - sizeof(len) - 1;
+            }
+            sw_log_put_(args, args_size, &len, sizeof(len));
+            sw_log_put_(args, args_size, value, len);
+            args[(*args_size)++] = '\0';
+        }
+    }
+    return 0;
+}
+
+/*
+ * Format a record like vsnprintf(), arguments are read from the captured ones.
+ */
+static void
+sw_log_format_(char *buf, size_t size, const char *fmt, const unsigned char *args, uint32_t args_size)
+{
+    sw_log_spec_t spec;
+    const char *p = fmt;
+    const char *percent;
+    size_t len = 0;
+    uint32_t offset = 0;
+    char spec_buf[32];
+    int stars[2];
+    int n;
+    int i;
+#define SW_LOG_TAKE_(value) \
+    do { \
+        if (offset + sizeof(value) > args_size) goto truncated; \
+        memcpy(&(value), args + offset, sizeof(value)); \
+        offset += sizeof(value); \
+    } while (0)
+#define SW_LOG_FORMAT_(value) \
+    (0 == spec.stars ? snprintf(buf + len, size - len, spec_buf, value) \
+     : 1 == spec.stars ? snprintf(buf + len, size - len, spec_buf, stars[0], value) \
+     : snprintf(buf + len, size - len, spec_buf, stars[0], stars[1], value))
+    buf[0] = '\0';
+    while (len < size - 1)
+    {
+        percent = strchr(p, '%');
+        n = NULL != percent ? (int)(percent - p) : (int)strlen(p);
+        if ((size_t)n > size - 1 - len)
+        {
+            n = (int)(size - 1 - len);
+        }
+        memcpy(buf + len, p, n);
+        len += n;
+        buf[len] = '\0';
+        if (NULL == percent || len >= size - 1)
+        {
+            return;
+        }
+        p = sw_log_parse_spec_(percent, &spec);
+        if (0 == spec.conv || (size_t)(spec.length_pos - spec.begin) + 4 > sizeof(spec_buf))
+        {
+            goto truncated;
+        }
+        for (i = 0; i < spec.stars; ++i)
+        {
+            long long star;
+            SW_LOG_TAKE_(star);
+            stars[i] = (int)star;
+        }
+        n = (int)(spec.length_pos - spec.begin);
+        memcpy(spec_buf, spec.begin, n);
+        n = 0;
+        if (NULL != strchr("diouxX", spec.conv))
+        {
+            long long value;
+            SW_LOG_TAKE_(value);
+            strcpy(spec_buf + (spec.length_pos - spec.begin), "ll");
+            spec_buf[(spec.length_pos - spec.begin) + 2] = spec.conv;
+            spec_buf[(spec.length_pos - spec.begin) + 3] = '\0';
+            n = NULL != strchr("di", spec.conv) ? SW_LOG_FORMAT_(value)
+                                                : SW_LOG_FORMAT_((unsigned long long)value);
+        }
+        else
+        {
+            char *conv = spec_buf + (spec.length_pos - spec.begin);
+            if ('L' == spec.length)
+            {
+                *conv++ = 'L';
+            }
+            conv[0] = spec.conv;
+            conv[1] = '\0';
+            if ('c' == spec.conv)
+            {
+                long long value;
+                SW_LOG_TAKE_(value);
+                n = SW_LOG_FORMAT_((int)value);
+            }
+            else if (NULL != strchr("fFeEgGaA", spec.conv) && 'L' == spec.length)
+            {
+                long double value;
+                SW_LOG_TAKE_(value);
+                n = SW_LOG_FORMAT_(value);
+            }
+            else if (NULL != strchr("fFeEgGaA", spec.conv))
+            {
+                double value;
+                SW_LOG_TAKE_(value);
+                n = SW_LOG_FORMAT_(value);
+            }
+            else if ('p' == spec.conv)
+            {
+                void *value;
+                SW_LOG_TAKE_(value);
+                n = SW_LOG_FORMAT_(value);
+            }
+            else if ('s' == spec.conv)
+            {
+                uint32_t str_len;
+                SW_LOG_TAKE_(str_len);
+                if (offset + str_len + 1 > args_size)
+                {
+                    goto truncated;
+                }
+                n = SW_LOG_FORMAT_((const char *)(args + offset));
+                offset += str_len + 1;
+            }
+            else if ('%' == spec.conv)
+            {
+                buf[len] = '%';
+                buf[len + 1] = '\0';
+                n = 1;
+            }
+        }
+        if (n > 0)
+        {
+            len += (size_t)n < size - len ? (size_t)n : size - 1 - len;
+        }
+    }
+    return;
+truncated:
+    snprintf(buf + len, size - len, "...");
+#undef SW_LOG_TAKE_
+#undef SW_LOG_FORMAT_
+}
+
+#ifndef _WIN32
+/*
+ * Mark the ring of an exited thread closed, the flusher frees it after draining.
+ * Only the owner thread closes its ring, so a ring is never freed while in use.
+ */
+static void
+sw_log_thread_exit_(void *value)
+{
+    SW_EV_STORE_RELEASE(&((sw_log_ring_t *)value)->closed, 1);
+}
+
+static void
+sw_log_key_create_()
+{
+    pthread_key_create(&sw_log_key_, sw_log_thread_exit_);
+}
+#endif
+
+static sw_log_ring_t *
+sw_log_thread_ring_get_()
+{
+    sw_log_ring_t *ring;
+    if (NULL != sw_log_thread_ring_ && sw_log_thread_generation_ == sw_log_generation_)
+    {
+        return sw_log_thread_ring_;
+    }
+    if (NULL != sw_log_thread_ring_)
+    {
+        /* left by a previous sw_log_async_start(), this thread won't touch it again */
+#ifndef _WIN32
+        pthread_setspecific(sw_log_key_, NULL);
+#endif
+        SW_EV_STORE_RELEASE(&sw_log_thread_ring_->closed, 1);
+        sw_log_thread_ring_ = NULL;
+    }
+    ring = (sw_log_ring_t *)sw_ev_malloc(sizeof(sw_log_ring_t));
+    if (NULL == ring)
+    {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(sw_log_ring_t));
+    ring->capacity = sw_log_ring_size_;
+    ring->buf = (unsigned char *)sw_ev_malloc(ring->capacity);
+    if (NULL == ring->buf)
+    {
+        sw_ev_free(ring);
+        return NULL;
+    }
+    sw_log_lock_acquire_();
+    if (!sw_log_async_running_ || sw_log_async_stopping_)
+    {
+        sw_log_lock_release_();
+        sw_ev_free(ring->buf);
+        sw_ev_free(ring);
+        return NULL;
+    }
+    ring->next = sw_log_rings_;
+    SW_EV_STORE_RELEASE(&sw_log_rings_, ring);
+    sw_log_thread_ring_ = ring;
+    sw_log_thread_generation_ = sw_log_generation_;
+#ifndef _WIN32
+    pthread_setspecific(sw_log_key_, ring);
+#endif
+    sw_log_lock_release_();
+    return ring;
+}
+
+/*
+ * Append a record to the thread's ring without blocking, drop it if the ring is full.
+ */
+static void
+sw_log_async_(int log_level, const char *fmt, va_list ap)
+{
+    unsigned char args[SW_LOG_ARGS_MAX];
+    sw_log_record_t record;
+    sw_log_ring_t *ring = sw_log_thread_ring_get_();
+    uint64_t head, tail;
+    uint32_t offset, contiguous, need;
+    if (NULL == ring)
+    {
+        return;
+    }
+    record.args_size = 0;
+    sw_log_capture_(fmt, ap, args, &record.args_size);
+    record.size = (uint32_t)(sizeof(record) + record.args_size + 7) & ~7u;
+    record.level = log_level;
+    record.reserved = 0;
+    record.fmt = fmt;
+    head = ring->head;
+    tail = SW_EV_LOAD_ACQUIRE(&ring->tail);
+    offset = (uint32_t)head & (ring->capacity - 1);
+    contiguous = ring->capacity - offset;
+    need = record.size <= contiguous ? record.size : contiguous + record.size;
+    if (head - tail + need > ring->capacity)
+    {
+        ring->dropped = ring->dropped + 1;
+        return;
+    }
+    if (record.size > contiguous)
+    {
+        sw_log_record_t *padding = (sw_log_record_t *)(ring->buf + offset);
+        padding->size = contiguous;
+        padding->level = SW_LOG_PADDING;
+        head += contiguous;
+        offset = 0;
+    }
+    memcpy(ring->buf + offset, &record, sizeof(record));
+    memcpy(ring->buf + offset + sizeof(record), args, record.args_size);
+    SW_EV_STORE_RELEASE(&ring->head, head + record.size);
+}
+
+/*
+ * Format and output the records of all rings, free closed rings after drained.
+ * return:  count of records output.
+ */
+static int
+sw_log_drain_()
+{
+    sw_log_ring_t *ring;
+    sw_log_ring_t **link;
+    char buf[4096];
+    int count = 0;
+    for (ring = SW_EV_LOAD_ACQUIRE(&sw_log_rings_); NULL != ring; ring = ring->next)
+    {
+        uint64_t tail = ring->tail;
+        uint64_t head = SW_EV_LOAD_ACQUIRE(&ring->head);
+        uint64_t dropped = ring->dropped;
+        while (tail < head)
+        {
+            sw_log_record_t *record = (sw_log_record_t *)(ring->buf + ((uint32_t)tail & (ring->capacity - 1)));
+            if (SW_LOG_PADDING != record->level && NULL != log_func)
+            {
+                sw_log_format_(buf, sizeof(buf), record->fmt,
+                               (unsigned char *)record + sizeof(sw_log_record_t), record->args_size);
+                log_func(record->level, buf);
+                ++count;
+            }
+            tail += record->size;
+            SW_EV_STORE_RELEASE(&ring->tail, tail);
+        }
+        if (dropped != ring->dropped_reported && NULL != log_func)
+        {
+            snprintf(buf, sizeof(buf), "%llu log messages dropped, ring of the thread is full",
+                     (unsigned long long)(dropped - ring->dropped_reported));
+            log_func(SW_LOG_WARN, buf);
+            ring->dropped_reported = dropped;
+        }
+    }
+    sw_log_lock_acquire_();
+    link = (sw_log_ring_t **)&sw_log_rings_;
+    while (NULL != (ring = *link))
+    {
+        if (SW_EV_LOAD_ACQUIRE(&ring->closed) && ring->tail == ring->head)
+        {
+            *link = ring->next;
+            sw_ev_free(ring->buf);
+            sw_ev_free(ring);
+        }
+        else
+        {
+            link = &ring->next;
+        }
+    }
+    sw_log_lock_release_();
+    return count;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall
+#else
+static void *
+#endif
+sw_log_flusher_run_(void *arg)
+{
+    while (!SW_EV_LOAD_ACQUIRE(&sw_log_async_stopping_))
+    {
+        if (0 == sw_log_drain_())
+        {
+#ifdef _WIN32
+            Sleep(SW_LOG_FLUSH_INTERVAL);
+#else
+            struct timespec ts = {0, SW_LOG_FLUSH_INTERVAL * 1000000};
+            nanosleep(&ts, NULL);
+#endif
+        }
+    }
+    sw_log_drain_();
+    return 0;
+}
+
+int sw_log_async_start(unsigned ring_size)
+{
+    uint32_t capacity = 4096;
+    if (0 == ring_size)
+    {
+        ring_size = SW_LOG_RING_SIZE;
+    }
+    while (capacity < ring_size && capacity < 0x40000000)
+    {
+        capacity <<= 1;
+    }
+#ifndef _WIN32
+    pthread_once(&sw_log_key_once_, sw_log_key_create_);
+#endif
+    sw_log_lock_acquire_();
+    if (sw_log_async_running_)
+    {
+        sw_log_lock_release_();
+        return -1;
+    }
+    sw_log_ring_size_ = capacity;
+    sw_log_async_stopping_ = 0;
+#ifdef _WIN32
+    sw_log_flusher_ = (HANDLE)_beginthreadex(NULL, 0, sw_log_flusher_run_, NULL, 0, NULL);
+    if (0 == sw_log_flusher_)
+#else
+    if (0 != pthread_create(&sw_log_flusher_, NULL, sw_log_flusher_run_, NULL))
+#endif
+    {
+        sw_log_lock_release_();
+        return -1;
+    }
+    ++sw_log_generation_;
+    SW_EV_STORE_RELEASE(&sw_log_async_running_, 1);
+    sw_log_lock_release_();
+    return 0;
+}
+
+/*
+ * Rings are not freed here, threads may still write their cached rings. Closed rings
+ * are freed by the flusher, the others stay drained until a thread closes them under
+ * a later sw_log_async_start().
+ */
+void sw_log_async_stop()
+{
+    sw_log_lock_acquire_();
+    if (!sw_log_async_running_ || sw_log_async_stopping_)
+    {
+        sw_log_lock_release_();
+        return;
+    }
+    SW_EV_STORE_RELEASE(&sw_log_async_stopping_, 1);
+    sw_log_lock_release_();
+#ifdef _WIN32
+    WaitForSingleObject(sw_log_flusher_, INFINITE);
+    CloseHandle(sw_log_flusher_);
+#else
+    pthread_join(sw_log_flusher_, NULL);
+#endif
+    sw_log_lock_acquire_();
+    SW_EV_STORE_RELEASE(&sw_log_async_running_, 0);
+    sw_log_async_stopping_ = 0;
+    sw_log_lock_release_();
+}
 
 static void sw_log(int log_level, const char *fmt, va_list ap)
 {
     char buf[4096];
+    if (SW_EV_LOAD_ACQUIRE(&sw_log_async_running_) && !sw_log_async_stopping_)
+    {
+        sw_log_async_(log_level, fmt, ap);
+        return;
+    }
     vsnprintf(buf, sizeof(buf), fmt, ap);
     log_func(log_level, buf);
 }
 
 void sw_log_error_exit(const char *fmt, ...)
 {
-    if (NULL != log_func)
+    if (NULL != log_func && SW_LOG_ERROR <= log_level)
     {
         va_list ap;
         va_start(ap, fmt);
         sw_log(SW_LOG_ERROR, fmt, ap);
         va_end(ap);
     }
+    sw_log_async_stop(); /* flush the queued messages, rings are kept for other threads */
     exit(1);
 }
 
 void sw_log_error(const char *fmt, ...)
 {
-    if (NULL != log_func)
+    if (NULL != log_func && SW_LOG_ERROR <= log_level)
     {
         va_list ap;
         va_start(ap, fmt);
@@ -38,7 +729,7 @@ void sw_log_error(const char *fmt, ...)
 
 void sw_log_warn(const char *fmt, ...)
 {
-    if (NULL != log_func)
+    if (NULL != log_func && SW_LOG_WARN <= log_level)
     {
         va_list ap;
         va_start(ap, fmt);
@@ -49,7 +740,7 @@ void sw_log_warn(const char *fmt, ...)
 
 void sw_log_msg(const char *fmt, ...)
 {
-    if (NULL != log_func)
+    if (NULL != log_func && SW_LOG_MSG <= log_level)
     {
         va_list ap;
         va_start(ap, fmt);
@@ -60,7 +751,7 @@ void sw_log_msg(const char *fmt, ...)
 
 void sw_log_debug(const char *fmt, ...)
 {
-    if (NULL != log_func)
+    if (NULL != log_func && SW_LOG_DEBUG <= log_level)
     {
         va_list ap;
         va_start(ap, fmt);
@@ -68,5 +759,3 @@ void sw_log_debug(const char *fmt, ...)
         va_end(ap);
     }
 }
-
-
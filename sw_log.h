@@ -6,12 +6,30 @@ extern "C"
 {
 #endif
 
+/*
+ * Least severe level compiled in, calls of less severe levels are removed with their
+ * arguments: 0 error, 1 warn, 2 msg, 3 debug.
+ */
+#ifndef SW_LOG_MIN_LEVEL
+#define SW_LOG_MIN_LEVEL 3
+#endif
+
 void sw_log_error_exit(const char *fmt, ...);
 void sw_log_error(const char *fmt, ...);
 void sw_log_warn(const char *fmt, ...);
 void sw_log_msg(const char *fmt, ...);
 void sw_log_debug(const char *fmt, ...);
 
+#if SW_LOG_MIN_LEVEL < 1
+#define sw_log_warn(...)  ((void)0)
+#endif
+#if SW_LOG_MIN_LEVEL < 2
+#define sw_log_msg(...)   ((void)0)
+#endif
+#if SW_LOG_MIN_LEVEL < 3
+#define sw_log_debug(...) ((void)0)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
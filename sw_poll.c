@@ -0,0 +1,210 @@
+#include "sw_event_internal.h"
+#ifndef _WIN32
+#include "sw_log.h"
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef POLLRDHUP
+#ifdef __linux__
+#define POLLRDHUP 0x2000 /* hidden by poll.h without _GNU_SOURCE */
+#else
+#define POLLRDHUP 0 /* only linux reports half-close */
+#endif
+#endif
+
+/*
+ * poll() backend. Changing interest costs no syscall, so it is cheaper than epoll
+ * when a context watches a few fds which change interest often.
+ * note: poll() is level triggered, a fd is reported by every poll-wait while it is
+ *       ready, so a SW_EV_WRITE interest should be deleted once nothing to write.
+ */
+
+struct sw_ev_poll
+{
+    struct pollfd * fds;
+    int             fds_count;
+    int             fds_capacity;
+    int           * index_of_fd; /* position in fds, -1 if fd is not polled */
+    int             index_count;
+};
+
+static int
+poll_init_(sw_ev_context_t *ctx)
+{
+    struct sw_ev_poll *state = (struct sw_ev_poll *)sw_ev_malloc(sizeof(struct sw_ev_poll));
+    if (NULL == state)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(state, 0, sizeof(struct sw_ev_poll));
+    ctx->backend_data = state;
+    return 0;
+}
+
+static void
+poll_destroy_(sw_ev_context_t *ctx)
+{
+    struct sw_ev_poll *state = (struct sw_ev_poll *)ctx->backend_data;
+    if (NULL != state)
+    {
+        sw_ev_free(state->fds);
+        sw_ev_free(state->index_of_fd);
+        sw_ev_free(state);
+        ctx->backend_data = NULL;
+    }
+}
+
+static int
+poll_reserve_(struct sw_ev_poll *state, int fd)
+{
+    if (fd >= state->index_count)
+    {
+        int count = state->index_count ? state->index_count : 64;
+        int *index_of_fd;
+        while (count <= fd)
+        {
+            count <<= 1;
+        }
+        index_of_fd = (int *)sw_ev_realloc(state->index_of_fd, count * sizeof(int));
+        if (NULL == index_of_fd)
+        {
+            sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+            return -1;
+        }
+        memset(index_of_fd + state->index_count, 0xff, (count - state->index_count) * sizeof(int));
+        state->index_of_fd = index_of_fd;
+        state->index_count = count;
+    }
+    if (state->fds_count == state->fds_capacity)
+    {
+        int capacity = state->fds_capacity ? state->fds_capacity * 2 : 16;
+        struct pollfd *fds = (struct pollfd *)sw_ev_realloc(state->fds, capacity * sizeof(struct pollfd));
+        if (NULL == fds)
+        {
+            sw_log_error("%s:%d sw_ev_realloc failed", __FILE__, __LINE__);
+            return -1;
+        }
+        state->fds = fds;
+        state->fds_capacity = capacity;
+    }
+    return 0;
+}
+
+static int
+poll_update_(sw_ev_context_t *ctx, int fd, int old_events, int new_events)
+{
+    struct sw_ev_poll *state = (struct sw_ev_poll *)ctx->backend_data;
+    int index = fd < state->index_count ? state->index_of_fd[fd] : -1;
+    short events = 0;
+    if (new_events & SW_EV_READ)
+    {
+        events |= POLLIN | POLLPRI | POLLRDHUP;
+    }
+    if (new_events & SW_EV_WRITE)
+    {
+        events |= POLLOUT;
+    }
+    if (-1 == index)
+    {
+        if (!events)
+        {
+            return 0;
+        }
+        if (-1 == poll_reserve_(state, fd))
+        {
+            return -1;
+        }
+        index = state->fds_count++;
+        state->index_of_fd[fd] = index;
+        state->fds[index].fd = fd;
+        state->fds[index].revents = 0;
+    }
+    else if (!events)
+    {
+        /* move the last one to the hole */
+        struct pollfd *last = &state->fds[--state->fds_count];
+        if (index != state->fds_count)
+        {
+            state->fds[index] = *last;
+            state->index_of_fd[last->fd] = index;
+        }
+        state->index_of_fd[fd] = -1;
+        return 0;
+    }
+    state->fds[index].events = events;
+    return 0;
+}
+
+static int
+poll_poll_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct sw_ev_poll *state = (struct sw_ev_poll *)ctx->backend_data;
+    int nfds = 0;
+    int i = 0;
+    int64_t poll_begin_time;
+    poll_begin_time = sw_ev_stats_poll_begin_(ctx);
+    nfds = poll(state->fds, state->fds_count, wait_time);
+    sw_ev_stats_poll_end_(ctx, poll_begin_time, nfds);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_POLL, poll_end, nfds);
+    if (nfds == -1)
+    {
+        if (SW_ERRNO != EINTR)
+        {
+            sw_log_error("%s:%d poll: %d", __FILE__, __LINE__, SW_ERRNO);
+            return -1;
+        }
+    }
+    /*
+     * callbacks may delete fds, the last one is moved to the hole and it is skipped if
+     * the hole was visited, it is reported again by next poll-wait for level triggered.
+     */
+    for (i = 0; i < state->fds_count && nfds > 0; i++)
+    {
+        short revents = state->fds[i].revents;
+        int what_events = 0;
+        if (!revents)
+        {
+            continue;
+        }
+        state->fds[i].revents = 0;
+        if (revents & POLLNVAL)
+        {
+            /* closed without sw_ev_io_del(), stop polling it like epoll does, and
+             * unregister it so stats, trim and dump don't see it as live */
+            sw_ev_io_del(ctx, state->fds[i].fd, SW_EV_READ | SW_EV_WRITE);
+            continue;
+        }
+        if (revents & (POLLIN | POLLPRI | POLLERR | POLLHUP | POLLRDHUP))
+        {
+            what_events |= SW_EV_READ;
+        }
+        if (revents & (POLLHUP | POLLRDHUP))
+        {
+            what_events |= SW_EV_CLOSED;
+        }
+        if (revents & POLLERR)
+        {
+            what_events |= SW_EV_ERROR;
+        }
+        if (revents & POLLPRI)
+        {
+            what_events |= SW_EV_PRI;
+        }
+        if (revents & POLLOUT)
+        {
+            what_events |= SW_EV_WRITE;
+        }
+        sw_ev_io_dispatch_(ctx, state->fds[i].fd, what_events);
+    }
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_IO, io_end, nfds);
+    return 0;
+}
+
+const sw_ev_backend_t sw_ev_backend_poll_ =
+{
+    "poll", poll_init_, poll_destroy_, poll_update_, poll_poll_, NULL
+};
+
+#endif /* !_WIN32 */
@@ -0,0 +1,517 @@
+#include "sw_pool.h"
+#include "sw_log.h"
+#include "sw_util.h"
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
+
+enum
+{
+    SW_EV_POOL_KEY_MAX = 24,      /* family, port, ipv6 address and scope id */
+    SW_EV_POOL_BUCKETS_MIN = 16,
+};
+
+typedef struct sw_ev_pool_conn
+{
+    struct sw_ev_pool       * pool;
+    int                       fd;
+    struct sw_ev_pool_host  * host;
+    sw_ev_batch_timer_t     * timer; /* idle timeout */
+    struct sw_ev_pool_conn  * prev;
+    struct sw_ev_pool_conn  * next;
+} sw_ev_pool_conn_t;
+
+typedef struct sw_ev_pool_host
+{
+    unsigned char             key[SW_EV_POOL_KEY_MAX];
+    int                       key_len;
+    uint32_t                  hash;
+    int                       active;     /* count of checked out and dialing connections */
+    int                       idle_count;
+    sw_ev_pool_conn_t       * idle;       /* most recently returned first */
+    struct sw_ev_pool_host  * next;       /* next in the bucket */
+} sw_ev_pool_host_t;
+
+typedef struct sw_ev_pool_dial
+{
+    struct sw_ev_pool       * pool;
+    sw_ev_pool_host_t       * host;
+    sw_ev_connector_t       * connector;
+    sw_ev_connect_cb_t        on_connect;
+    void                    * arg;
+    struct sw_ev_pool_dial  * prev;
+    struct sw_ev_pool_dial  * next;
+} sw_ev_pool_dial_t;
+
+struct sw_ev_pool
+{
+    sw_ev_context_t         * ctx;
+    int                       max_per_host;
+    sw_ev_timer_group_t     * idle_timers;
+    sw_ev_pool_host_t      ** buckets;
+    unsigned                  bucket_count; /* power of 2 */
+    unsigned                  host_count;
+    sw_ev_pool_dial_t       * dials;
+};
+
+/*
+ * Build the key of an upstream address, ignoring padding and flow info.
+ * return:  length of key, -1 not an IPv4 or IPv6 address.
+ */
+static int
+sw_ev_pool_key_(const struct sockaddr *addr, int addr_len, unsigned char *key)
+{
+    if (NULL == addr)
+    {
+        return -1;
+    }
+    if (AF_INET == addr->sa_family && addr_len >= (int)sizeof(struct sockaddr_in))
+    {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+        key[0] = 4;
+        memcpy(key + 1, &in->sin_port, 2);
+        memcpy(key + 3, &in->sin_addr, 4);
+        return 7;
+    }
+    if (AF_INET6 == addr->sa_family && addr_len >= (int)sizeof(struct sockaddr_in6))
+    {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+        key[0] = 6;
+        memcpy(key + 1, &in6->sin6_port, 2);
+        memcpy(key + 3, &in6->sin6_addr, 16);
+        memcpy(key + 19, &in6->sin6_scope_id, 4);
+        return 23;
+    }
+    return -1;
+}
+
+static uint32_t
+sw_ev_pool_hash_(const unsigned char *key, int key_len)
+{
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    int i;
+    for (i = 0; i < key_len; ++i)
+    {
+        hash = (hash ^ key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static sw_ev_pool_host_t *
+sw_ev_pool_find_(sw_ev_pool_t *pool, const unsigned char *key, int key_len, uint32_t hash)
+{
+    sw_ev_pool_host_t *host = pool->buckets[hash & (pool->bucket_count - 1)];
+    for (; NULL != host; host = host->next)
+    {
+        if (host->hash == hash && host->key_len == key_len && 0 == memcmp(host->key, key, key_len))
+        {
+            return host;
+        }
+    }
+    return NULL;
+}
+
+static sw_ev_pool_host_t *
+sw_ev_pool_lookup_(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len)
+{
+    unsigned char key[SW_EV_POOL_KEY_MAX];
+    int key_len = sw_ev_pool_key_(addr, addr_len, key);
+    if (-1 == key_len)
+    {
+        return NULL;
+    }
+    return sw_ev_pool_find_(pool, key, key_len, sw_ev_pool_hash_(key, key_len));
+}
+
+static int
+sw_ev_pool_grow_(sw_ev_pool_t *pool)
+{
+    unsigned count = pool->bucket_count * 2;
+    sw_ev_pool_host_t **buckets;
+    sw_ev_pool_host_t *host;
+    unsigned i;
+    buckets = (sw_ev_pool_host_t **)sw_ev_malloc(count * sizeof(sw_ev_pool_host_t *));
+    if (NULL == buckets)
+    {
+        return -1;
+    }
+    memset(buckets, 0, count * sizeof(sw_ev_pool_host_t *));
+    for (i = 0; i < pool->bucket_count; ++i)
+    {
+        while (NULL != (host = pool->buckets[i]))
+        {
+            pool->buckets[i] = host->next;
+            host->next = buckets[host->hash & (count - 1)];
+            buckets[host->hash & (count - 1)] = host;
+        }
+    }
+    sw_ev_free(pool->buckets);
+    pool->buckets = buckets;
+    pool->bucket_count = count;
+    return 0;
+}
+
+/*
+ * Find the host of addr, create it if not found.
+ */
+static sw_ev_pool_host_t *
+sw_ev_pool_host_get_(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len)
+{
+    unsigned char key[SW_EV_POOL_KEY_MAX];
+    sw_ev_pool_host_t *host;
+    sw_ev_pool_host_t **bucket;
+    uint32_t hash;
+    int key_len = sw_ev_pool_key_(addr, addr_len, key);
+    if (-1 == key_len)
+    {
+        sw_log_error("%s:%d not an IPv4 or IPv6 address", __FILE__, __LINE__);
+        return NULL;
+    }
+    hash = sw_ev_pool_hash_(key, key_len);
+    host = sw_ev_pool_find_(pool, key, key_len, hash);
+    if (NULL != host)
+    {
+        return host;
+    }
+    if (pool->host_count >= pool->bucket_count && -1 == sw_ev_pool_grow_(pool))
+    {
+        sw_log_warn("%s:%d can't grow hosts table", __FILE__, __LINE__); /* longer chains then */
+    }
+    host = (sw_ev_pool_host_t *)sw_ev_malloc(sizeof(sw_ev_pool_host_t));
+    if (NULL == host)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(host, 0, sizeof(sw_ev_pool_host_t));
+    memcpy(host->key, key, key_len);
+    host->key_len = key_len;
+    host->hash = hash;
+    bucket = &pool->buckets[hash & (pool->bucket_count - 1)];
+    host->next = *bucket;
+    *bucket = host;
+    ++pool->host_count;
+    return host;
+}
+
+/*
+ * Free the host once it has no connection.
+ */
+static void
+sw_ev_pool_host_put_(sw_ev_pool_t *pool, sw_ev_pool_host_t *host)
+{
+    sw_ev_pool_host_t **link;
+    if (host->active > 0 || host->idle_count > 0)
+    {
+        return;
+    }
+    for (link = &pool->buckets[host->hash & (pool->bucket_count - 1)]; *link != host; link = &(*link)->next)
+    {
+    }
+    *link = host->next;
+    --pool->host_count;
+    sw_ev_free(host);
+}
+
+static void
+sw_ev_pool_unlink_idle_(sw_ev_pool_conn_t *conn)
+{
+    sw_ev_pool_host_t *host = conn->host;
+    if (NULL != conn->prev)
+    {
+        conn->prev->next = conn->next;
+    }
+    else
+    {
+        host->idle = conn->next;
+    }
+    if (NULL != conn->next)
+    {
+        conn->next->prev = conn->prev;
+    }
+    --host->idle_count;
+}
+
+static void
+sw_ev_pool_close_idle_(sw_ev_pool_t *pool, sw_ev_pool_conn_t *conn)
+{
+    sw_ev_pool_host_t *host = conn->host;
+    sw_ev_pool_unlink_idle_(conn);
+    sw_ev_batch_timer_del(conn->timer);
+    sw_ev_io_del(pool->ctx, conn->fd, SW_EV_READ);
+    SW_EV_CLOSESOCKET(conn->fd);
+    sw_ev_free(conn);
+    sw_ev_pool_host_put_(pool, host);
+}
+
+/*
+ * An idle connection turned readable, the upstream closed it or sent something
+ * unexpected, it can't be reused.
+ */
+static void
+sw_ev_pool_idle_ready_(int fd, int events, void *arg)
+{
+    sw_ev_pool_conn_t *conn = (sw_ev_pool_conn_t *)arg;
+    sw_ev_pool_close_idle_(conn->pool, conn);
+}
+
+static void
+sw_ev_pool_idle_timeout_(sw_ev_batch_timer_t **timers, int count, void *arg)
+{
+    sw_ev_pool_t *pool = (sw_ev_pool_t *)arg;
+    int i;
+    for (i = 0; i < count; ++i)
+    {
+        if (NULL != timers[i]->group) /* not closed earlier in this callback */
+        {
+            sw_ev_pool_close_idle_(pool, (sw_ev_pool_conn_t *)timers[i]->arg);
+        }
+    }
+}
+
+sw_ev_pool_t *
+sw_ev_pool_new(sw_ev_context_t *ctx, int max_per_host, int idle_timeout_ms)
+{
+    sw_ev_pool_t *pool;
+    if (NULL == ctx || max_per_host < 0 || idle_timeout_ms <= 0)
+    {
+        return NULL;
+    }
+    pool = (sw_ev_pool_t *)sw_ev_malloc(sizeof(sw_ev_pool_t));
+    if (NULL == pool)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return NULL;
+    }
+    memset(pool, 0, sizeof(sw_ev_pool_t));
+    pool->ctx = ctx;
+    pool->max_per_host = max_per_host;
+    pool->bucket_count = SW_EV_POOL_BUCKETS_MIN;
+    pool->buckets = (sw_ev_pool_host_t **)sw_ev_malloc(pool->bucket_count * sizeof(sw_ev_pool_host_t *));
+    pool->idle_timers = sw_ev_timer_group_new(ctx, idle_timeout_ms, sw_ev_pool_idle_timeout_, pool);
+    if (NULL == pool->buckets || NULL == pool->idle_timers)
+    {
+        sw_log_error("%s:%d can't create connection pool", __FILE__, __LINE__);
+        if (NULL != pool->idle_timers)
+        {
+            sw_ev_timer_group_free(pool->idle_timers);
+        }
+        sw_ev_free(pool->buckets);
+        sw_ev_free(pool);
+        return NULL;
+    }
+    memset(pool->buckets, 0, pool->bucket_count * sizeof(sw_ev_pool_host_t *));
+    return pool;
+}
+
+void
+sw_ev_pool_free(sw_ev_pool_t *pool)
+{
+    sw_ev_pool_dial_t *dials;
+    sw_ev_pool_dial_t *dial;
+    sw_ev_pool_host_t *host;
+    sw_ev_pool_conn_t *conn;
+    unsigned i;
+    if (NULL == pool)
+    {
+        return;
+    }
+    dials = pool->dials;
+    for (dial = dials; NULL != dial; dial = dial->next)
+    {
+        sw_ev_connect_cancel(dial->connector);
+    }
+    for (i = 0; i < pool->bucket_count; ++i)
+    {
+        while (NULL != (host = pool->buckets[i]))
+        {
+            pool->buckets[i] = host->next;
+            while (NULL != (conn = host->idle))
+            {
+                host->idle = conn->next;
+                sw_ev_io_del(pool->ctx, conn->fd, SW_EV_READ);
+                SW_EV_CLOSESOCKET(conn->fd);
+                sw_ev_free(conn);
+            }
+            sw_ev_free(host);
+        }
+    }
+    sw_ev_timer_group_free(pool->idle_timers); /* frees members of idle connections */
+    sw_ev_free(pool->buckets);
+    sw_ev_free(pool);
+    /* called back after the pool is freed, so they can't use it any more */
+    while (NULL != (dial = dials))
+    {
+        dials = dial->next;
+        dial->on_connect(-1, ECANCELED, dial->arg);
+        sw_ev_free(dial);
+    }
+}
+
+int
+sw_ev_pool_checkout(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len)
+{
+    sw_ev_pool_host_t *host = sw_ev_pool_lookup_(pool, addr, addr_len);
+    sw_ev_pool_conn_t *conn;
+    int fd;
+    if (NULL == host || NULL == host->idle)
+    {
+        return -1;
+    }
+    conn = host->idle;
+    sw_ev_pool_unlink_idle_(conn);
+    sw_ev_batch_timer_del(conn->timer);
+    sw_ev_io_del(pool->ctx, conn->fd, SW_EV_READ);
+    ++host->active;
+    fd = conn->fd;
+    sw_ev_free(conn);
+    return fd;
+}
+
+static void
+sw_ev_pool_dialed_(int fd, int error, void *arg)
+{
+    sw_ev_pool_dial_t *dial = (sw_ev_pool_dial_t *)arg;
+    sw_ev_pool_t *pool = dial->pool;
+    sw_ev_connect_cb_t on_connect = dial->on_connect;
+    void *on_connect_arg = dial->arg;
+    if (NULL != dial->prev)
+    {
+        dial->prev->next = dial->next;
+    }
+    else
+    {
+        pool->dials = dial->next;
+    }
+    if (NULL != dial->next)
+    {
+        dial->next->prev = dial->prev;
+    }
+    if (-1 == fd)
+    {
+        --dial->host->active;
+        sw_ev_pool_host_put_(pool, dial->host);
+    }
+    sw_ev_free(dial);
+    on_connect(fd, error, on_connect_arg);
+}
+
+int
+sw_ev_pool_dial(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len,
+                int timeout_ms, sw_ev_connect_cb_t on_connect, void *arg)
+{
+    sw_ev_pool_host_t *host;
+    sw_ev_pool_dial_t *dial;
+    if (NULL == on_connect)
+    {
+        return -1;
+    }
+    host = sw_ev_pool_host_get_(pool, addr, addr_len);
+    if (NULL == host)
+    {
+        return -1;
+    }
+    if (pool->max_per_host > 0 && host->active + host->idle_count >= pool->max_per_host)
+    {
+        sw_ev_pool_host_put_(pool, host);
+        return -1;
+    }
+    dial = (sw_ev_pool_dial_t *)sw_ev_malloc(sizeof(sw_ev_pool_dial_t));
+    if (NULL == dial)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        sw_ev_pool_host_put_(pool, host);
+        return -1;
+    }
+    memset(dial, 0, sizeof(sw_ev_pool_dial_t));
+    dial->pool = pool;
+    dial->host = host;
+    dial->on_connect = on_connect;
+    dial->arg = arg;
+    dial->connector = sw_ev_connect_addr(pool->ctx, addr, addr_len, timeout_ms, sw_ev_pool_dialed_, dial);
+    if (NULL == dial->connector)
+    {
+        sw_ev_free(dial);
+        sw_ev_pool_host_put_(pool, host);
+        return -1;
+    }
+    ++host->active;
+    dial->next = pool->dials;
+    if (NULL != pool->dials)
+    {
+        pool->dials->prev = dial;
+    }
+    pool->dials = dial;
+    return 0;
+}
+
+void
+sw_ev_pool_return(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len,
+                  int fd, int reusable)
+{
+    sw_ev_pool_host_t *host = sw_ev_pool_lookup_(pool, addr, addr_len);
+    sw_ev_pool_conn_t *conn;
+    if (NULL == host || host->active <= 0)
+    {
+        sw_log_error("%s:%d fd %d wasn't taken from the pool", __FILE__, __LINE__, fd);
+        SW_EV_CLOSESOCKET(fd);
+        return;
+    }
+    --host->active;
+    if (!reusable)
+    {
+        SW_EV_CLOSESOCKET(fd);
+        sw_ev_pool_host_put_(pool, host);
+        return;
+    }
+    conn = (sw_ev_pool_conn_t *)sw_ev_malloc(sizeof(sw_ev_pool_conn_t));
+    if (NULL == conn)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        SW_EV_CLOSESOCKET(fd);
+        sw_ev_pool_host_put_(pool, host);
+        return;
+    }
+    conn->pool = pool;
+    conn->fd = fd;
+    conn->host = host;
+    conn->prev = NULL;
+    /* drop interest and callback left by the user, any event closes an idle connection */
+    sw_ev_io_del(pool->ctx, fd, SW_EV_READ | SW_EV_WRITE);
+    conn->timer = sw_ev_batch_timer_add(pool->idle_timers, conn);
+    if (NULL == conn->timer
+        || -1 == sw_ev_io_add(pool->ctx, fd, SW_EV_READ, sw_ev_pool_idle_ready_, conn))
+    {
+        sw_log_error("%s:%d can't keep idle connection %d", __FILE__, __LINE__, fd);
+        if (NULL != conn->timer)
+        {
+            sw_ev_batch_timer_del(conn->timer);
+        }
+        SW_EV_CLOSESOCKET(fd);
+        sw_ev_free(conn);
+        sw_ev_pool_host_put_(pool, host);
+        return;
+    }
+    conn->next = host->idle;
+    if (NULL != host->idle)
+    {
+        host->idle->prev = conn;
+    }
+    host->idle = conn;
+    ++host->idle_count;
+}
+
+int
+sw_ev_pool_idle(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len)
+{
+    sw_ev_pool_host_t *host = sw_ev_pool_lookup_(pool, addr, addr_len);
+    return NULL != host ? host->idle_count : 0;
+}
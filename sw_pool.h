@@ -0,0 +1,96 @@
+/**
+ * Outbound connection pool for libswevent.
+ * Connections to upstreams are kept per sw_ev_context and keyed by the upstream address
+ * (family, ip and port). A request takes a warm connection by sw_ev_pool_checkout(),
+ * or dials a new one by sw_ev_pool_dial() when none is idle, and gives it back by
+ * sw_ev_pool_return() when the response is complete.
+ * Idle connections are watched for readability: an idle connection has nothing to
+ * read, so a readable one was closed by the upstream or is out of sync, it's closed
+ * and dropped at once. Idle connections are closed after idle_timeout_ms, by one timer
+ * group of the context for the whole pool.
+ */
+#ifndef INC_SW_POOL_H
+#define INC_SW_POOL_H
+
+#include "sw_event.h"
+#include "sw_connector.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+typedef struct sw_ev_pool sw_ev_pool_t;
+
+/**
+ * Create a connection pool of ctx.
+ * param:   ctx - operated sw_ev_context pointer which return by sw_ev_context_new().
+ *          max_per_host - max count of connections of an upstream, checked out, dialing
+ *                         and idle ones together, 0 for no limit.
+ *          idle_timeout_ms - idle connections are closed after it.
+ * return:  not NULL success, NULL failed.
+ * note:    You must use sw_ev_pool_free() to release it before freeing ctx.
+ */
+sw_ev_pool_t * sw_ev_pool_new(sw_ev_context_t *ctx, int max_per_host, int idle_timeout_ms);
+
+/**
+ * Close idle connections, cancel dials in progress, and free the pool. Checked out
+ * connections stay open and are owned by their users.
+ * note:    on_connect of each cancelled dial is called with fd -1 and error ECANCELED
+ *          after the pool is freed, so it must not use the pool.
+ */
+void sw_ev_pool_free(sw_ev_pool_t *pool);
+
+/**
+ * Take the most recently returned idle connection of the upstream.
+ * param:   pool - pool pointer returned by sw_ev_pool_new().
+ *          addr, addr_len - upstream address.
+ * return:  fd of the connection, -1 none is idle.
+ * note:    The connection isn't watched by the pool any more, give it back by
+ *          sw_ev_pool_return() in any case.
+ */
+int  sw_ev_pool_checkout(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len);
+
+/**
+ * Dial a new connection to the upstream by sw_ev_connect_addr(), it's counted as
+ * checked out when connected.
+ * param:   pool - pool pointer returned by sw_ev_pool_new().
+ *          addr, addr_len - upstream address.
+ *          timeout_ms - deadline of the connect, 0 for no deadline.
+ *          on_connect - the same as sw_ev_connect_addr().
+ *          arg - user data pointer passed to on_connect.
+ * return:  0 dialing, -1 failed without calling back, e.g. max_per_host reached.
+ */
+int  sw_ev_pool_dial(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len,
+                     int timeout_ms, sw_ev_connect_cb_t on_connect, void *arg);
+
+/**
+ * Give back a connection taken by sw_ev_pool_checkout() or sw_ev_pool_dial().
+ * param:   pool - pool pointer returned by sw_ev_pool_new().
+ *          addr, addr_len - upstream address, the same as when it was taken.
+ *          fd - the connection, it's owned by the pool after this call.
+ *          reusable - 1 it's idle and can serve another request, 0 close it, e.g. it
+ *                     failed or the upstream asked to close.
+ * note:    Events of fd registered by the user are unregistered.
+ */
+void sw_ev_pool_return(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len,
+                       int fd, int reusable);
+
+/**
+ * Get count of idle connections of the upstream.
+ */
+int  sw_ev_pool_idle(sw_ev_pool_t *pool, const struct sockaddr *addr, int addr_len);
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
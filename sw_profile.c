@@ -0,0 +1,266 @@
+#include "sw_event_internal.h"
+#include "sw_log.h"
+#include <string.h>
+
+#ifdef SW_EV_PROFILE
+
+struct sw_ev_profiler
+{
+    int64_t slow_threshold;  /* us */
+    void (*slow_hook)(const sw_ev_callback_profile_t *profile, void *callback_arg,
+                      int64_t elapsed_us, void *arg);
+    void *arg;
+    sw_ev_callback_profile_t * profiles; /* open addressing by (callback, kind) */
+    unsigned capacity;                   /* power of 2 */
+    unsigned count;
+};
+
+static int
+sw_ev_profile_bucket_(int64_t elapsed)
+{
+    int exponent = 4;
+    if (elapsed < 16)
+    {
+        return elapsed < 0 ? 0 : (int)elapsed;
+    }
+    if (elapsed >= ((int64_t)1 << 32))
+    {
+        return SW_EV_PROFILE_BUCKETS - 1;
+    }
+#ifdef __GNUC__
+    exponent = 63 - __builtin_clzll((unsigned long long)elapsed);
+#else
+    while ((elapsed >> (exponent + 1)) != 0)
+    {
+        ++exponent;
+    }
+#endif
+    return 16 + (exponent - 4) * 8 + (int)((elapsed >> (exponent - 3)) & 7);
+}
+
+static int64_t
+sw_ev_profile_bucket_upper_(int bucket)
+{
+    int exponent, sub;
+    if (bucket < 16)
+    {
+        return bucket;
+    }
+    exponent = 4 + (bucket - 16) / 8;
+    sub = (bucket - 16) % 8;
+    return ((int64_t)(8 + sub + 1) << (exponent - 3)) - 1;
+}
+
+static unsigned
+sw_ev_profile_hash_(void *callback, int kind)
+{
+    uint64_t key = (uint64_t)(uintptr_t)callback ^ (uint64_t)kind;
+    return (unsigned)((key * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+static sw_ev_callback_profile_t *
+sw_ev_profile_lookup_(struct sw_ev_profiler *profiler, void *callback, int kind)
+{
+    unsigned slot = sw_ev_profile_hash_(callback, kind) & (profiler->capacity - 1);
+    sw_ev_callback_profile_t *profile;
+    while (1)
+    {
+        profile = &profiler->profiles[slot];
+        if (NULL == profile->callback
+            || (profile->callback == callback && profile->kind == kind))
+        {
+            return profile;
+        }
+        slot = (slot + 1) & (profiler->capacity - 1);
+    }
+}
+
+static int
+sw_ev_profile_grow_(struct sw_ev_profiler *profiler)
+{
+    sw_ev_callback_profile_t *old_profiles = profiler->profiles;
+    unsigned old_capacity = profiler->capacity;
+    unsigned capacity = old_capacity ? old_capacity * 2 : 16;
+    unsigned i;
+    sw_ev_callback_profile_t *profiles =
+        (sw_ev_callback_profile_t *)sw_ev_malloc(capacity * sizeof(sw_ev_callback_profile_t));
+    if (NULL == profiles)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(profiles, 0, capacity * sizeof(sw_ev_callback_profile_t));
+    profiler->profiles = profiles;
+    profiler->capacity = capacity;
+    for (i = 0; i < old_capacity; ++i)
+    {
+        if (NULL != old_profiles[i].callback)
+        {
+            memcpy(sw_ev_profile_lookup_(profiler, old_profiles[i].callback, old_profiles[i].kind),
+                   &old_profiles[i], sizeof(sw_ev_callback_profile_t));
+        }
+    }
+    sw_ev_free(old_profiles);
+    return 0;
+}
+
+void
+sw_ev_profile_record_(sw_ev_context_t *ctx, int kind, void *callback,
+                      void *callback_arg, int64_t begin_time)
+{
+    struct sw_ev_profiler *profiler = ctx->profiler;
+    int64_t elapsed = sw_ev_gettime_us() - begin_time;
+    sw_ev_callback_profile_t *profile;
+    if (NULL == profiler) /* disabled by the callback */
+    {
+        return;
+    }
+    profile = sw_ev_profile_lookup_(profiler, callback, kind);
+    if (NULL == profile->callback)
+    {
+        if ((profiler->count + 1) * 2 > profiler->capacity)
+        {
+            if (-1 == sw_ev_profile_grow_(profiler))
+            {
+                return;
+            }
+            profile = sw_ev_profile_lookup_(profiler, callback, kind);
+        }
+        profile->callback = callback;
+        profile->kind = kind;
+        ++profiler->count;
+    }
+    ++profile->count;
+    profile->total_time += elapsed;
+    if (elapsed > profile->max_time)
+    {
+        profile->max_time = elapsed;
+    }
+    ++profile->buckets[sw_ev_profile_bucket_(elapsed)];
+    if (profiler->slow_threshold > 0 && elapsed >= profiler->slow_threshold
+        && NULL != profiler->slow_hook)
+    {
+        profiler->slow_hook(profile, callback_arg, elapsed, profiler->arg);
+    }
+}
+
+int
+sw_ev_profile_enable(sw_ev_context_t *ctx, int64_t slow_threshold_us,
+                     void (*slow_hook)(const sw_ev_callback_profile_t *profile,
+                                       void *callback_arg, int64_t elapsed_us,
+                                       void *arg),
+                     void *arg)
+{
+    struct sw_ev_profiler *profiler;
+    sw_ev_profile_disable(ctx);
+    profiler = (struct sw_ev_profiler *)sw_ev_malloc(sizeof(struct sw_ev_profiler));
+    if (NULL == profiler)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    memset(profiler, 0, sizeof(struct sw_ev_profiler));
+    profiler->slow_threshold = slow_threshold_us;
+    profiler->slow_hook = slow_hook;
+    profiler->arg = arg;
+    if (-1 == sw_ev_profile_grow_(profiler))
+    {
+        sw_ev_free(profiler);
+        return -1;
+    }
+    ctx->profiler = profiler;
+    return 0;
+}
+
+void
+sw_ev_profile_disable(sw_ev_context_t *ctx)
+{
+    if (NULL != ctx->profiler)
+    {
+        sw_ev_free(ctx->profiler->profiles);
+        sw_ev_free(ctx->profiler);
+        ctx->profiler = NULL;
+    }
+}
+
+int
+sw_ev_profile_foreach(sw_ev_context_t *ctx,
+                      void (*fn)(const sw_ev_callback_profile_t *profile, void *arg),
+                      void *arg)
+{
+    struct sw_ev_profiler *profiler = ctx->profiler;
+    unsigned i;
+    if (NULL == profiler)
+    {
+        return -1;
+    }
+    for (i = 0; i < profiler->capacity; ++i)
+    {
+        if (NULL != profiler->profiles[i].callback)
+        {
+            fn(&profiler->profiles[i], arg);
+        }
+    }
+    return (int)profiler->count;
+}
+
+int64_t
+sw_ev_profile_percentile(const sw_ev_callback_profile_t *profile, double percentile)
+{
+    uint64_t rank, seen = 0;
+    int i;
+    if (NULL == profile || 0 == profile->count)
+    {
+        return 0;
+    }
+    if (percentile >= 100.0)
+    {
+        return profile->max_time;
+    }
+    rank = (uint64_t)(profile->count * (percentile < 0.0 ? 0.0 : percentile) / 100.0);
+    for (i = 0; i < SW_EV_PROFILE_BUCKETS; ++i)
+    {
+        seen += profile->buckets[i];
+        if (seen > rank)
+        {
+            int64_t upper = sw_ev_profile_bucket_upper_(i);
+            return upper < profile->max_time ? upper : profile->max_time;
+        }
+    }
+    return profile->max_time;
+}
+
+#else /* SW_EV_PROFILE */
+
+int
+sw_ev_profile_enable(sw_ev_context_t *ctx, int64_t slow_threshold_us,
+                     void (*slow_hook)(const sw_ev_callback_profile_t *profile,
+                                       void *callback_arg, int64_t elapsed_us,
+                                       void *arg),
+                     void *arg)
+{
+    sw_log_error("%s:%d sw_ev_profile_enable: libswevent is built without SW_EV_PROFILE.",
+                 __FILE__, __LINE__);
+    return -1;
+}
+
+void
+sw_ev_profile_disable(sw_ev_context_t *ctx)
+{
+}
+
+int
+sw_ev_profile_foreach(sw_ev_context_t *ctx,
+                      void (*fn)(const sw_ev_callback_profile_t *profile, void *arg),
+                      void *arg)
+{
+    return -1;
+}
+
+int64_t
+sw_ev_profile_percentile(const sw_ev_callback_profile_t *profile, double percentile)
+{
+    return 0;
+}
+
+#endif /* SW_EV_PROFILE */
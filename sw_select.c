@@ -0,0 +1,160 @@
+#include "sw_event_internal.h"
+#ifdef _WIN32
+#include "sw_log.h"
+#include <windows.h>
+#include <string.h>
+
+/*
+ * select backend for Windows, at most FD_SETSIZE sockets for each of read and write.
+ */
+
+struct sw_ev_select
+{
+    fd_set  read_set;
+    fd_set  write_set;
+    fd_set  except_set;
+};
+
+struct sw_ev_fd_list
+{
+    int  fds[3*FD_SETSIZE];
+    int  events[3*FD_SETSIZE];
+    int  fd_count;
+};
+
+static void push_to_result_fd_list(struct sw_ev_fd_list * fd_list, int fd, int what_events)
+{
+    int i = 0;
+    for ( ; i < fd_list->fd_count; ++i)
+    {
+        if (fd_list->fds[i] == fd)
+        {
+            fd_list->events[i] |= what_events;
+            return;
+        }
+    }
+    if (fd_list->fd_count < 3*FD_SETSIZE)
+    {
+        fd_list->fds[fd_list->fd_count] = fd;
+        fd_list->events[fd_list->fd_count] = what_events;
+        ++fd_list->fd_count;
+    }
+}
+
+static int
+select_init_(sw_ev_context_t *ctx)
+{
+    struct sw_ev_select *sets = (struct sw_ev_select *)sw_ev_malloc(sizeof(struct sw_ev_select));
+    if (NULL == sets)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    FD_ZERO(&sets->read_set);
+    FD_ZERO(&sets->write_set);
+    FD_ZERO(&sets->except_set);
+    ctx->backend_data = sets;
+    return 0;
+}
+
+static void
+select_destroy_(sw_ev_context_t *ctx)
+{
+    sw_ev_free(ctx->backend_data);
+    ctx->backend_data = NULL;
+}
+
+static int
+select_update_(sw_ev_context_t *ctx, int fd, int old_events, int new_events)
+{
+    struct sw_ev_select *sets = (struct sw_ev_select *)ctx->backend_data;
+    if ((new_events & ~old_events & SW_EV_READ) && sets->read_set.fd_count >= FD_SETSIZE)
+    {
+        return -1;
+    }
+    if ((new_events & ~old_events & SW_EV_WRITE) && sets->write_set.fd_count >= FD_SETSIZE)
+    {
+        return -1;
+    }
+    if (new_events & SW_EV_READ)
+    {
+        FD_SET(fd, &sets->read_set);
+    }
+    else
+    {
+        FD_CLR(fd, &sets->read_set);
+    }
+    /* a failed non-blocking connect is only reported in except set */
+    if (new_events & SW_EV_WRITE)
+    {
+        FD_SET(fd, &sets->write_set);
+        FD_SET(fd, &sets->except_set);
+    }
+    else
+    {
+        FD_CLR(fd, &sets->write_set);
+        FD_CLR(fd, &sets->except_set);
+    }
+    return 0;
+}
+
+static int
+select_poll_(sw_ev_context_t *ctx, int wait_time)
+{
+    struct sw_ev_select *sets = (struct sw_ev_select *)ctx->backend_data;
+    fd_set read_set, write_set, except_set;
+    int nfds = 0;
+    int i = 0;
+    struct timeval tv = {0, 0};
+    struct sw_ev_fd_list res_fd_list;
+    int64_t poll_begin_time;
+    tv.tv_sec = wait_time / 1000;
+    tv.tv_usec = wait_time % 1000 * 1000;
+    memcpy(&read_set, &sets->read_set, sizeof(fd_set));
+    memcpy(&write_set, &sets->write_set, sizeof(fd_set));
+    memcpy(&except_set, &sets->except_set, sizeof(fd_set));
+    memset(&res_fd_list, 0, sizeof(res_fd_list));
+    poll_begin_time = sw_ev_stats_poll_begin_(ctx);
+    if (0 == read_set.fd_count && 0 == write_set.fd_count && 0 == except_set.fd_count)
+    {
+        /* select() fails with WSAEINVAL without sockets, e.g. timers only and lazy signals */
+        Sleep(wait_time < 0 ? INFINITE : (DWORD)wait_time);
+        nfds = 0;
+    }
+    else
+    {
+        nfds = select(0, &read_set, &write_set, &except_set, wait_time < 0 ? NULL : &tv);
+    }
+    sw_ev_stats_poll_end_(ctx, poll_begin_time, nfds);
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_POLL, poll_end, nfds);
+    if (-1 == nfds)
+    {
+        sw_log_error("%s:%d select: %d", __FILE__, __LINE__, SW_ERRNO);
+        return -1;
+    }
+    for (i = 0; i < (int)read_set.fd_count; i++)
+    {
+        push_to_result_fd_list(&res_fd_list, read_set.fd_array[i], SW_EV_READ);
+    }
+    for (i = 0; i < (int)write_set.fd_count; i++)
+    {
+        push_to_result_fd_list(&res_fd_list, write_set.fd_array[i], SW_EV_WRITE);
+    }
+    for (i = 0; i < (int)except_set.fd_count; i++)
+    {
+        push_to_result_fd_list(&res_fd_list, except_set.fd_array[i], SW_EV_WRITE | SW_EV_ERROR);
+    }
+    for (i = 0; i < res_fd_list.fd_count; ++i)
+    {
+        sw_ev_io_dispatch_(ctx, res_fd_list.fds[i], res_fd_list.events[i]);
+    }
+    SW_EV_TRACE_MARK(ctx, SW_EV_TRACE_IO, io_end, nfds);
+    return 0;
+}
+
+const sw_ev_backend_t sw_ev_backend_select_ =
+{
+    "select", select_init_, select_destroy_, select_update_, select_poll_, NULL
+};
+
+#endif /* _WIN32 */
@@ -3,13 +3,17 @@
 
 #include "sw_event.h"
 
+#ifdef SW_EV_TIMER_HEAP4
+#include "sw_timer_heap4.h"
+#else
+
 #if defined(_WIN32) && !defined(__cplusplus)
 #define inline __inline
 #endif
 
 extern void* (*sw_ev_malloc)(size_t);
-void  (*sw_ev_free)(void *);
-void* (*sw_ev_realloc)(void *, size_t);
+extern void  (*sw_ev_free)(void *);
+extern void* (*sw_ev_realloc)(void *, size_t);
 
 typedef struct sw_timer_heap /* it's a min heap */
 {
@@ -21,9 +25,12 @@ static inline void            sw_timer_heap_ctor(sw_timer_heap_t *heap);
 static inline void            sw_timer_heap_dtor(sw_timer_heap_t *heap);
 static inline void            sw_timer_heap_elem_init(sw_ev_timer_t *e);
 static inline int             sw_timer_heap_elem_greater(sw_ev_timer_t *left, sw_ev_timer_t *right);
+static inline int             sw_timer_heap_empty(sw_timer_heap_t *heap);
 static inline unsigned        sw_timer_heap_size(sw_timer_heap_t *heap);
 static inline sw_ev_timer_t * sw_timer_heap_top(sw_timer_heap_t *heap);
+static inline sw_ev_timer_t * sw_timer_heap_at(sw_timer_heap_t *heap, unsigned index);
 static inline int             sw_timer_heap_reserve(sw_timer_heap_t *heap, unsigned size);
+static inline size_t          sw_timer_heap_shrink(sw_timer_heap_t *heap);
 static inline int             sw_timer_heap_push(sw_timer_heap_t *heap, sw_ev_timer_t *e);
 static inline sw_ev_timer_t * sw_timer_heap_pop(sw_timer_heap_t *heap);
 static inline int             sw_timer_heap_erase(sw_timer_heap_t *heap, sw_ev_timer_t *e);
@@ -73,6 +80,11 @@ sw_ev_timer_t *sw_timer_heap_top(sw_timer_heap_t *heap)
     return heap->size ? *heap->timers : 0;
 }
 
+sw_ev_timer_t *sw_timer_heap_at(sw_timer_heap_t *heap, unsigned index)
+{
+    return heap->timers[index];
+}
+
 int sw_timer_heap_push(sw_timer_heap_t* heap, sw_ev_timer_t* e)
 {
     if(sw_timer_heap_reserve(heap, heap->size + 1))
@@ -132,6 +144,26 @@ int sw_timer_heap_reserve(sw_timer_heap_t* heap, unsigned size)
     return 0;
 }
 
+/*
+ * Halve capacity while less than a quarter is used, so at most half is free afterwards.
+ * Return the count of bytes released.
+ */
+size_t sw_timer_heap_shrink(sw_timer_heap_t* heap)
+{
+    sw_ev_timer_t **timers;
+    unsigned capacity = heap->capacity;
+    while(capacity > 8 && heap->size < capacity / 4)
+        capacity /= 2;
+    if(capacity == heap->capacity)
+        return 0;
+    if(!(timers = (sw_ev_timer_t**)sw_ev_realloc(heap->timers, capacity * sizeof *timers)))
+        return 0;
+    heap->timers = timers;
+    capacity = heap->capacity - capacity;
+    heap->capacity -= capacity;
+    return capacity * sizeof *timers;
+}
+
 void sw_timer_heap_shift_up_(sw_timer_heap_t* heap, unsigned hole_index, sw_ev_timer_t* e)
 {
     unsigned parent = (hole_index - 1) / 2;
@@ -164,5 +196,6 @@ void sw_timer_heap_shift_down_(sw_timer_heap_t* heap, unsigned hole_index, sw_ev
     sw_timer_heap_shift_up_(heap, hole_index,  e);
 }
 
+#endif /* SW_EV_TIMER_HEAP4 */
 
 #endif
@@ -0,0 +1,218 @@
+#ifndef INC_SW_TIMER_HEAP4_H
+#define INC_SW_TIMER_HEAP4_H
+
+#include "sw_event.h"
+
+#if defined(_WIN32) && !defined(__cplusplus)
+#define inline __inline
+#endif
+
+extern void* (*sw_ev_malloc)(size_t);
+extern void  (*sw_ev_free)(void *);
+extern void* (*sw_ev_realloc)(void *, size_t);
+
+/*
+ * 4-ary min heap, it has the same interface with the binary heap in sw_timer_heap.h.
+ * The expire time is copied into the heap array beside the timer pointer, so comparisons
+ * never dereference timers, and the 4 children of a node are adjacent (64 bytes on 64-bit,
+ * at 4i+1..4i+4, so without an aligned array they usually span two cache lines).
+ * The timer's next_expire_time must not be changed while it is in the heap.
+ */
+typedef struct sw_timer_heap_entry
+{
+    int64_t         expire_time; /* copy of timer->next_expire_time */
+    sw_ev_timer_t * timer;
+} sw_timer_heap_entry_t;
+
+typedef struct sw_timer_heap /* it's a min heap */
+{
+    sw_timer_heap_entry_t * entries;
+    unsigned size, capacity;
+} sw_timer_heap_t;
+
+static inline void            sw_timer_heap_ctor(sw_timer_heap_t *heap);
+static inline void            sw_timer_heap_dtor(sw_timer_heap_t *heap);
+static inline void            sw_timer_heap_elem_init(sw_ev_timer_t *e);
+static inline int             sw_timer_heap_empty(sw_timer_heap_t *heap);
+static inline unsigned        sw_timer_heap_size(sw_timer_heap_t *heap);
+static inline sw_ev_timer_t * sw_timer_heap_top(sw_timer_heap_t *heap);
+static inline sw_ev_timer_t * sw_timer_heap_at(sw_timer_heap_t *heap, unsigned index);
+static inline int             sw_timer_heap_reserve(sw_timer_heap_t *heap, unsigned size);
+static inline size_t          sw_timer_heap_shrink(sw_timer_heap_t *heap);
+static inline int             sw_timer_heap_push(sw_timer_heap_t *heap, sw_ev_timer_t *e);
+static inline sw_ev_timer_t * sw_timer_heap_pop(sw_timer_heap_t *heap);
+static inline int             sw_timer_heap_erase(sw_timer_heap_t *heap, sw_ev_timer_t *e);
+static inline void            sw_timer_heap_shift_up_(sw_timer_heap_t *heap, unsigned hole_index, sw_timer_heap_entry_t e);
+static inline void            sw_timer_heap_shift_down_(sw_timer_heap_t *heap, unsigned hole_index, sw_timer_heap_entry_t e);
+
+void sw_timer_heap_ctor(sw_timer_heap_t *heap)
+{
+    heap->entries = 0;
+    heap->size = 0;
+    heap->capacity = 0;
+}
+
+void sw_timer_heap_dtor(sw_timer_heap_t *heap)
+{
+    if(heap->entries)
+    {
+        sw_ev_free(heap->entries);
+        heap->entries = 0;
+        heap->size = 0;
+        heap->capacity = 0;
+    }
+}
+
+void sw_timer_heap_elem_init(sw_ev_timer_t *e)
+{
+    e->index_in_heap = -1;
+}
+
+int sw_timer_heap_empty(sw_timer_heap_t *heap)
+{
+    return 0 == heap->size;
+}
+
+unsigned sw_timer_heap_size(sw_timer_heap_t *heap)
+{
+    return heap->size;
+}
+
+sw_ev_timer_t *sw_timer_heap_top(sw_timer_heap_t *heap)
+{
+    return heap->size ? heap->entries->timer : 0;
+}
+
+sw_ev_timer_t *sw_timer_heap_at(sw_timer_heap_t *heap, unsigned index)
+{
+    return heap->entries[index].timer;
+}
+
+int sw_timer_heap_push(sw_timer_heap_t* heap, sw_ev_timer_t* e)
+{
+    sw_timer_heap_entry_t entry;
+    if(sw_timer_heap_reserve(heap, heap->size + 1))
+    {
+        return -1;
+    }
+    entry.expire_time = e->next_expire_time;
+    entry.timer = e;
+    sw_timer_heap_shift_up_(heap, heap->size++, entry);
+    return 0;
+}
+
+sw_ev_timer_t * sw_timer_heap_pop(sw_timer_heap_t* heap)
+{
+    if(heap->size)
+    {
+        sw_ev_timer_t* e = heap->entries->timer;
+        if (--heap->size)
+        {
+            sw_timer_heap_shift_down_(heap, 0u, heap->entries[heap->size]);
+        }
+        e->index_in_heap = -1;
+        return e;
+    }
+    return 0;
+}
+
+int sw_timer_heap_erase(sw_timer_heap_t* heap, sw_ev_timer_t* e)
+{
+    if(((unsigned int)-1) != e->index_in_heap)
+    {
+        sw_timer_heap_entry_t last = heap->entries[--heap->size];
+        unsigned index = e->index_in_heap;
+        if (index != heap->size)
+        {
+            /* replace e with last element*/
+            if (index > 0 && heap->entries[(index - 1) / 4].expire_time > last.expire_time)
+            {
+                sw_timer_heap_shift_up_(heap, index, last);
+            }
+            else
+            {
+                sw_timer_heap_shift_down_(heap, index, last);
+            }
+        }
+        e->index_in_heap = -1;
+        return 0;
+    }
+    return -1;
+}
+
+int sw_timer_heap_reserve(sw_timer_heap_t* heap, unsigned size)
+{
+    if(heap->capacity < size)
+    {
+        sw_timer_heap_entry_t *entries;
+        unsigned capacity = heap->capacity ? heap->capacity * 2 : 8;
+        if(capacity < size)
+            capacity = size;
+        if(!(entries = (sw_timer_heap_entry_t*)sw_ev_realloc(heap->entries, capacity * sizeof *entries)))
+            return -1;
+        heap->entries = entries;
+        heap->capacity = capacity;
+    }
+    return 0;
+}
+
+size_t sw_timer_heap_shrink(sw_timer_heap_t* heap)
+{
+    sw_timer_heap_entry_t *entries;
+    unsigned capacity = heap->capacity;
+    while(capacity > 8 && heap->size < capacity / 4)
+        capacity /= 2;
+    if(capacity == heap->capacity)
+        return 0;
+    if(!(entries = (sw_timer_heap_entry_t*)sw_ev_realloc(heap->entries, capacity * sizeof *entries)))
+        return 0;
+    heap->entries = entries;
+    capacity = heap->capacity - capacity;
+    heap->capacity -= capacity;
+    return capacity * sizeof *entries;
+}
+
+void sw_timer_heap_shift_up_(sw_timer_heap_t* heap, unsigned hole_index, sw_timer_heap_entry_t e)
+{
+    unsigned parent;
+    while(hole_index)
+    {
+        parent = (hole_index - 1) / 4;
+        if (heap->entries[parent].expire_time <= e.expire_time)
+        {
+            break;
+        }
+        heap->entries[hole_index] = heap->entries[parent];
+        heap->entries[hole_index].timer->index_in_heap = hole_index;
+        hole_index = parent;
+    }
+    heap->entries[hole_index] = e;
+    e.timer->index_in_heap = hole_index;
+}
+
+void sw_timer_heap_shift_down_(sw_timer_heap_t* heap, unsigned hole_index, sw_timer_heap_entry_t e)
+{
+    unsigned child, last_child, min_child;
+    while((child = 4 * hole_index + 1) < heap->size)
+    {
+        last_child = child + 3 < heap->size ? child + 3 : heap->size - 1;
+        for (min_child = child++; child <= last_child; ++child)
+        {
+            if (heap->entries[child].expire_time < heap->entries[min_child].expire_time)
+            {
+                min_child = child;
+            }
+        }
+        if (heap->entries[min_child].expire_time >= e.expire_time)
+        {
+            break;
+        }
+        heap->entries[hole_index] = heap->entries[min_child];
+        heap->entries[hole_index].timer->index_in_heap = hole_index;
+        hole_index = min_child;
+    }
+    heap->entries[hole_index] = e;
+    e.timer->index_in_heap = hole_index;
+}
+
+#endif
@@ -0,0 +1,191 @@
+#include "sw_event_internal.h"
+#include "sw_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+typedef struct sw_ev_trace_record
+{
+    int64_t begin_time; /* us */
+    int64_t end_time;   /* us */
+    int     phase;
+    int     count;
+} sw_ev_trace_record_t;
+
+/*
+ * Single producer ring buffer. The loop thread writes a record then publishes it by
+ * increasing head, readers copy records and drop those may be overwritten meanwhile.
+ */
+struct sw_ev_tracer
+{
+    sw_ev_trace_record_t * records;
+    unsigned  capacity; /* power of 2 */
+    volatile uint64_t head; /* count of records ever written */
+    int64_t   mark_time;
+};
+
+/*
+ * Guards swapping and freeing ctx->tracer against sw_ev_trace_dump() from other
+ * threads. The loop thread writes records without it, only start, stop and the
+ * snapshot of dump take it, so a spin lock is enough.
+ */
+static volatile int sw_ev_trace_lock_ = 0;
+
+static void
+sw_ev_trace_lock_acquire_()
+{
+    while (!CAS(&sw_ev_trace_lock_, 0, 1))
+    {
+#ifdef _WIN32
+        Sleep(0);
+#else
+        sched_yield();
+#endif
+    }
+}
+
+static void
+sw_ev_trace_lock_release_()
+{
+    SW_EV_STORE_RELEASE(&sw_ev_trace_lock_, 0);
+}
+
+static const char * sw_ev_trace_phase_names_[] =
+{
+    "timers", "prepare", "poll_wait", "io_dispatch", "check"
+};
+
+void
+sw_ev_trace_mark_(sw_ev_context_t *ctx, int phase, int count)
+{
+    struct sw_ev_tracer *tracer = ctx->tracer;
+    int64_t now = sw_ev_gettime_us();
+    if (phase >= 0)
+    {
+        uint64_t head = tracer->head;
+        sw_ev_trace_record_t *record = &tracer->records[head & (tracer->capacity - 1)];
+        record->begin_time = tracer->mark_time;
+        record->end_time = now;
+        record->phase = phase;
+        record->count = count;
+        SW_EV_STORE_RELEASE(&tracer->head, head + 1);
+    }
+    tracer->mark_time = now;
+}
+
+int
+sw_ev_trace_start(sw_ev_context_t *ctx, unsigned capacity)
+{
+    struct sw_ev_tracer *tracer;
+    unsigned size = 64;
+    while (size < capacity && size < 0x80000000u)
+    {
+        size <<= 1;
+    }
+    sw_ev_trace_stop(ctx);
+    tracer = (struct sw_ev_tracer *)sw_ev_malloc(sizeof(struct sw_ev_tracer));
+    if (NULL == tracer)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    tracer->records = (sw_ev_trace_record_t *)sw_ev_malloc(size * sizeof(sw_ev_trace_record_t));
+    if (NULL == tracer->records)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        sw_ev_free(tracer);
+        return -1;
+    }
+    tracer->capacity = size;
+    tracer->head = 0;
+    tracer->mark_time = sw_ev_gettime_us();
+    sw_ev_trace_lock_acquire_();
+    ctx->tracer = tracer;
+    sw_ev_trace_lock_release_();
+    return 0;
+}
+
+void
+sw_ev_trace_stop(sw_ev_context_t *ctx)
+{
+    struct sw_ev_tracer *tracer = ctx->tracer;
+    if (NULL != tracer)
+    {
+        sw_ev_trace_lock_acquire_(); /* wait for a dump copying it */
+        ctx->tracer = NULL;
+        sw_ev_trace_lock_release_();
+        sw_ev_free(tracer->records);
+        sw_ev_free(tracer);
+    }
+}
+
+int
+sw_ev_trace_dump(sw_ev_context_t *ctx, const char *path)
+{
+    struct sw_ev_tracer *tracer;
+    sw_ev_trace_record_t *copy;
+    uint64_t head, tail, i;
+    unsigned capacity;
+    unsigned tid = (unsigned)(((uintptr_t)ctx >> 4) & 0xffffff);
+    int written = 0;
+    FILE *fp;
+    sw_ev_trace_lock_acquire_();
+    tracer = ctx->tracer;
+    if (NULL == tracer)
+    {
+        sw_ev_trace_lock_release_();
+        return -1;
+    }
+    capacity = tracer->capacity;
+    copy = (sw_ev_trace_record_t *)sw_ev_malloc(capacity * sizeof(sw_ev_trace_record_t));
+    if (NULL == copy)
+    {
+        sw_ev_trace_lock_release_();
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        return -1;
+    }
+    head = SW_EV_LOAD_ACQUIRE(&tracer->head);
+    memcpy(copy, tracer->records, capacity * sizeof(sw_ev_trace_record_t));
+    /* the writer may have overwritten the oldest records during copying */
+    tail = SW_EV_LOAD_ACQUIRE(&tracer->head);
+    sw_ev_trace_lock_release_();
+    tail = tail >= capacity ? tail - capacity + 1 : 0;
+    if (head > capacity && tail < head - capacity)
+    {
+        tail = head - capacity;
+    }
+    fp = fopen(path, "w");
+    if (NULL == fp)
+    {
+        sw_log_error("%s:%d fopen %s: %d", __FILE__, __LINE__, path, SW_ERRNO);
+        sw_ev_free(copy);
+        return -1;
+    }
+    fprintf(fp, "{\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                "\"args\":{\"name\":\"sw_ev_context %p\"}}",
+            (int)getpid(), tid, (void *)ctx);
+    for (i = tail; i < head; ++i)
+    {
+        sw_ev_trace_record_t *record = &copy[i & (capacity - 1)];
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"loop\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                    "\"ts\":%lld,\"dur\":%lld,\"args\":{\"count\":%d}}",
+                sw_ev_trace_phase_names_[record->phase], (int)getpid(), tid,
+                (long long)record->begin_time,
+                (long long)(record->end_time - record->begin_time),
+                record->count);
+        ++written;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    sw_ev_free(copy);
+    return written;
+}
@@ -4,6 +4,7 @@
 #include <sys/timeb.h>
 #else
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <fcntl.h>
@@ -26,6 +27,25 @@ int64_t sw_ev_gettime_ms()
 #endif
 }
 
+int64_t sw_ev_gettime_us()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (0 == frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart / frequency.QuadPart * 1000000
+           + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+#endif
+}
+
 int sw_ev_setnonblock(int fd)
 {
 #ifdef _WIN32
@@ -2,13 +2,23 @@
 #define INC_SW_UTIL_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility push(default) /* exported when built with -fvisibility=hidden */
+#endif
+
+extern void* (*sw_ev_malloc)(size_t);
+extern void  (*sw_ev_free)(void *);
+extern void* (*sw_ev_realloc)(void *, size_t);
+
 int64_t  sw_ev_gettime_ms();
+int64_t  sw_ev_gettime_us(); /* monotonic clock, only for measuring durations */
 int sw_ev_setnonblock(int fd);
 int sw_ev_socketpair(int fd[2]);
 
@@ -28,6 +38,10 @@ int sw_ev_socketpair(int fd[2]);
     __sync_bool_compare_and_swap(ptr, old_val, new_val)
 #endif
 
+#if defined(__GNUC__) && !defined(_WIN32)
+#pragma GCC visibility pop
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,385 @@
+#include "sw_event_internal.h"
+#include "sw_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define SW_EV_BACKTRACE
+#endif
+#endif
+#endif
+
+#ifndef SW_EV_WATCHDOG_SIGNAL
+#define SW_EV_WATCHDOG_SIGNAL SIGURG /* ignored by default, so a late one is harmless */
+#endif
+
+/*
+ * Written by the loop thread, read by the watchdog thread without locking.
+ */
+struct sw_ev_watchdog
+{
+    sw_ev_context_t * ctx;
+    int     threshold; /* ms */
+    int     flags;
+    void  (*stall_hook)(const sw_ev_stall_t *stall, void *arg);
+    void  * arg;
+    volatile int64_t heartbeat;  /* us, 0 when the loop is idle */
+    volatile int64_t enter_time; /* us, when the running callback was called */
+    void * volatile  callback;   /* running callback, NULL for none */
+    void * volatile  callback_arg;
+    volatile int     kind;
+    volatile int     stop;
+#ifdef _WIN32
+    HANDLE           thread;
+#else
+    pthread_t        thread;
+    pthread_t        loop_thread; /* published by heartbeat */
+    volatile int     frames_count; /* -1 while capturing */
+    void           * frames[SW_EV_WATCHDOG_FRAMES];
+#endif
+};
+
+void
+sw_ev_watchdog_beat_(sw_ev_context_t *ctx, int idle)
+{
+    struct sw_ev_watchdog *watchdog = ctx->watchdog;
+    if (idle)
+    {
+        SW_EV_STORE_RELEASE(&watchdog->heartbeat, 0);
+        return;
+    }
+#ifndef _WIN32
+    watchdog->loop_thread = pthread_self();
+#endif
+    SW_EV_STORE_RELEASE(&watchdog->heartbeat, sw_ev_gettime_us());
+}
+
+void
+sw_ev_watchdog_enter_(sw_ev_context_t *ctx, int kind, void *callback, void *callback_arg)
+{
+    struct sw_ev_watchdog *watchdog = ctx->watchdog;
+    watchdog->kind = kind;
+    watchdog->callback_arg = callback_arg;
+    watchdog->enter_time = NULL != callback ? sw_ev_gettime_us() : 0;
+    SW_EV_STORE_RELEASE(&watchdog->callback, callback);
+}
+
+static void
+sw_ev_watchdog_sleep_(int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = ms % 1000 * 1000000;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+#ifdef SW_EV_BACKTRACE
+
+/* one capture at a time in the process, the signal handler finds the watchdog here */
+static pthread_mutex_t sw_ev_watchdog_capture_lock_ = PTHREAD_MUTEX_INITIALIZER;
+static struct sw_ev_watchdog * volatile sw_ev_watchdog_capturing_ = NULL;
+static volatile int sw_ev_watchdog_in_handler_ = 0; /* count of handlers that may write frames */
+static int sw_ev_watchdog_handler_users_ = 0; /* watchdogs capturing backtraces */
+static struct sigaction sw_ev_watchdog_old_action_; /* chained to, and restored by the last user */
+
+static void
+sw_ev_watchdog_signal_handler_(int signal_no, siginfo_t *info, void *context)
+{
+    struct sw_ev_watchdog *watchdog;
+    int saved_errno = errno;
+    /* counted before looking at the capture, so the capturer can wait for it to finish */
+    __atomic_add_fetch(&sw_ev_watchdog_in_handler_, 1, __ATOMIC_SEQ_CST);
+    watchdog = __atomic_load_n(&sw_ev_watchdog_capturing_, __ATOMIC_SEQ_CST);
+    if (NULL != watchdog && pthread_equal(pthread_self(), watchdog->loop_thread)
+        && -1 == watchdog->frames_count)
+    {
+        int frames_count = backtrace(watchdog->frames, SW_EV_WATCHDOG_FRAMES);
+        SW_EV_STORE_RELEASE(&watchdog->frames_count, frames_count);
+        __atomic_sub_fetch(&sw_ev_watchdog_in_handler_, 1, __ATOMIC_SEQ_CST);
+    }
+    else
+    {
+        __atomic_sub_fetch(&sw_ev_watchdog_in_handler_, 1, __ATOMIC_SEQ_CST);
+        /* not ours, e.g. out-of-band data of a socket, pass it to the previous handler */
+        if (sw_ev_watchdog_old_action_.sa_flags & SA_SIGINFO)
+        {
+            if (NULL != sw_ev_watchdog_old_action_.sa_sigaction)
+            {
+                sw_ev_watchdog_old_action_.sa_sigaction(signal_no, info, context);
+            }
+        }
+        else if (SIG_DFL != sw_ev_watchdog_old_action_.sa_handler
+                 && SIG_IGN != sw_ev_watchdog_old_action_.sa_handler)
+        {
+            sw_ev_watchdog_old_action_.sa_handler(signal_no);
+        }
+    }
+    errno = saved_errno;
+}
+
+static int
+sw_ev_watchdog_install_handler_()
+{
+    struct sigaction action;
+    void *frames[1];
+    int ret = 0;
+    pthread_mutex_lock(&sw_ev_watchdog_capture_lock_);
+    if (0 == sw_ev_watchdog_handler_users_)
+    {
+        /* the first backtrace() loads libgcc, which isn't safe in a signal handler */
+        backtrace(frames, 1);
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = sw_ev_watchdog_signal_handler_;
+        action.sa_flags = SA_RESTART | SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        if (-1 == sigaction(SW_EV_WATCHDOG_SIGNAL, &action, &sw_ev_watchdog_old_action_))
+        {
+            sw_log_error("%s:%d sigaction: %d", __FILE__, __LINE__, SW_ERRNO);
+            ret = -1;
+        }
+    }
+    if (0 == ret)
+    {
+        ++sw_ev_watchdog_handler_users_;
+    }
+    pthread_mutex_unlock(&sw_ev_watchdog_capture_lock_);
+    return ret;
+}
+
+static void
+sw_ev_watchdog_uninstall_handler_()
+{
+    pthread_mutex_lock(&sw_ev_watchdog_capture_lock_);
+    if (0 == --sw_ev_watchdog_handler_users_)
+    {
+        sigaction(SW_EV_WATCHDOG_SIGNAL, &sw_ev_watchdog_old_action_, NULL);
+    }
+    pthread_mutex_unlock(&sw_ev_watchdog_capture_lock_);
+}
+
+/*
+ * Signal the loop thread and wait at most 100ms for its backtrace.
+ */
+static void
+sw_ev_watchdog_backtrace_(struct sw_ev_watchdog *watchdog, sw_ev_stall_t *stall)
+{
+    int i;
+    int frames_count;
+    pthread_mutex_lock(&sw_ev_watchdog_capture_lock_);
+    watchdog->frames_count = -1;
+    SW_EV_STORE_RELEASE(&sw_ev_watchdog_capturing_, watchdog);
+    if (0 == pthread_kill(watchdog->loop_thread, SW_EV_WATCHDOG_SIGNAL))
+    {
+        for (i = 0; i < 100 && -1 == SW_EV_LOAD_ACQUIRE(&watchdog->frames_count); ++i)
+        {
+            sw_ev_watchdog_sleep_(1);
+        }
+    }
+    __atomic_store_n(&sw_ev_watchdog_capturing_, NULL, __ATOMIC_SEQ_CST);
+    /* a late handler which still saw the capture may be writing frames, wait for it */
+    while (0 != __atomic_load_n(&sw_ev_watchdog_in_handler_, __ATOMIC_SEQ_CST))
+    {
+        sw_ev_watchdog_sleep_(1);
+    }
+    frames_count = SW_EV_LOAD_ACQUIRE(&watchdog->frames_count);
+    if (frames_count > 0)
+    {
+        memcpy(stall->frames, watchdog->frames, frames_count * sizeof(void *));
+        stall->frames_count = frames_count;
+    }
+    pthread_mutex_unlock(&sw_ev_watchdog_capture_lock_);
+}
+
+#endif /* SW_EV_BACKTRACE */
+
+/*
+ * Undo sw_ev_watchdog_install_handler_() of a watchdog started with flags.
+ */
+static void
+sw_ev_watchdog_release_handler_(int flags)
+{
+#ifdef SW_EV_BACKTRACE
+    if (flags & SW_EV_WATCHDOG_BACKTRACE)
+    {
+        sw_ev_watchdog_uninstall_handler_();
+    }
+#endif
+}
+
+static const char * sw_ev_watchdog_kind_names_[] =
+{
+    "no", "io", "timer", "prepare", "check", "signal"
+};
+
+static void
+sw_ev_watchdog_log_(const sw_ev_stall_t *stall)
+{
+    sw_log_error("%s:%d event loop stalled %lldms, in %s callback %p(arg %p) for %lldms",
+                 __FILE__, __LINE__, (long long)stall->stalled_time,
+                 sw_ev_watchdog_kind_names_[stall->kind], stall->callback, stall->arg,
+                 (long long)stall->callback_time);
+#ifdef SW_EV_BACKTRACE
+    if (stall->frames_count > 0)
+    {
+        int i;
+        char **symbols = backtrace_symbols((void * const *)stall->frames, stall->frames_count);
+        for (i = 0; i < stall->frames_count; ++i)
+        {
+            sw_log_error("    #%d %s", i, NULL != symbols ? symbols[i] : "?");
+        }
+        free(symbols);
+    }
+#endif
+}
+
+/*
+ * Report the stall once if the heartbeat is older than threshold.
+ */
+static void
+sw_ev_watchdog_check_(struct sw_ev_watchdog *watchdog, int64_t *reported_heartbeat)
+{
+    int64_t heartbeat = SW_EV_LOAD_ACQUIRE(&watchdog->heartbeat);
+    int64_t now = sw_ev_gettime_us();
+    sw_ev_stall_t stall;
+    if (0 == heartbeat || heartbeat == *reported_heartbeat
+        || now - heartbeat < (int64_t)watchdog->threshold * 1000)
+    {
+        return;
+    }
+    *reported_heartbeat = heartbeat;
+    memset(&stall, 0, sizeof(stall));
+    stall.ctx = watchdog->ctx;
+    stall.stalled_time = (now - heartbeat) / 1000;
+    stall.callback = SW_EV_LOAD_ACQUIRE(&watchdog->callback);
+    if (NULL != stall.callback)
+    {
+        stall.kind = watchdog->kind;
+        stall.arg = watchdog->callback_arg;
+        stall.callback_time = (now - watchdog->enter_time) / 1000;
+    }
+#ifdef SW_EV_BACKTRACE
+    if (watchdog->flags & SW_EV_WATCHDOG_BACKTRACE)
+    {
+        sw_ev_watchdog_backtrace_(watchdog, &stall);
+    }
+#endif
+    if (NULL != watchdog->stall_hook)
+    {
+        watchdog->stall_hook(&stall, watchdog->arg);
+    }
+    else
+    {
+        sw_ev_watchdog_log_(&stall);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall
+#else
+static void *
+#endif
+sw_ev_watchdog_run_(void *arg)
+{
+    struct sw_ev_watchdog *watchdog = (struct sw_ev_watchdog *)arg;
+    int64_t reported_heartbeat = 0;
+    int interval = watchdog->threshold / 4;
+    if (interval < 1)
+    {
+        interval = 1;
+    }
+    else if (interval > 100)
+    {
+        interval = 100;
+    }
+    while (!SW_EV_LOAD_ACQUIRE(&watchdog->stop))
+    {
+        sw_ev_watchdog_sleep_(interval);
+        sw_ev_watchdog_check_(watchdog, &reported_heartbeat);
+    }
+    return 0;
+}
+
+int
+sw_ev_watchdog_start(sw_ev_context_t *ctx, int threshold_ms, int flags,
+                     void (*stall_hook)(const sw_ev_stall_t *stall, void *arg),
+                     void *arg)
+{
+    struct sw_ev_watchdog *watchdog;
+    if (threshold_ms <= 0)
+    {
+        return -1;
+    }
+#ifdef SW_EV_BACKTRACE
+    if ((flags & SW_EV_WATCHDOG_BACKTRACE) && -1 == sw_ev_watchdog_install_handler_())
+    {
+        return -1;
+    }
+#endif
+    sw_ev_watchdog_stop(ctx);
+    watchdog = (struct sw_ev_watchdog *)sw_ev_malloc(sizeof(struct sw_ev_watchdog));
+    if (NULL == watchdog)
+    {
+        sw_log_error("%s:%d sw_ev_malloc failed", __FILE__, __LINE__);
+        sw_ev_watchdog_release_handler_(flags);
+        return -1;
+    }
+    memset(watchdog, 0, sizeof(struct sw_ev_watchdog));
+    watchdog->ctx = ctx;
+    watchdog->threshold = threshold_ms;
+    watchdog->flags = flags;
+    watchdog->stall_hook = stall_hook;
+    watchdog->arg = arg;
+#ifdef _WIN32
+    watchdog->thread = (HANDLE)_beginthreadex(NULL, 0, sw_ev_watchdog_run_, watchdog, 0, NULL);
+    if (0 == watchdog->thread)
+    {
+        sw_log_error("%s:%d _beginthreadex: %d", __FILE__, __LINE__, SW_ERRNO);
+        sw_ev_free(watchdog);
+        return -1;
+    }
+#else
+    if (0 != pthread_create(&watchdog->thread, NULL, sw_ev_watchdog_run_, watchdog))
+    {
+        sw_log_error("%s:%d pthread_create failed", __FILE__, __LINE__);
+        sw_ev_free(watchdog);
+        sw_ev_watchdog_release_handler_(flags);
+        return -1;
+    }
+#endif
+    ctx->watchdog = watchdog;
+    return 0;
+}
+
+void
+sw_ev_watchdog_stop(sw_ev_context_t *ctx)
+{
+    struct sw_ev_watchdog *watchdog = ctx->watchdog;
+    if (NULL == watchdog)
+    {
+        return;
+    }
+    ctx->watchdog = NULL;
+    SW_EV_STORE_RELEASE(&watchdog->stop, 1);
+#ifdef _WIN32
+    WaitForSingleObject(watchdog->thread, INFINITE);
+    CloseHandle(watchdog->thread);
+#else
+    pthread_join(watchdog->thread, NULL);
+#endif
+    /* the joined thread waited for the handler of its last capture */
+    sw_ev_watchdog_release_handler_(watchdog->flags);
+    sw_ev_free(watchdog);
+}
@@ -0,0 +1,79 @@
+/*
+ * Check messages formatted by the asynchronous logging flusher against vsnprintf(),
+ * for every supported conversion.
+ * usage: log_format, exit status 0 if all match.
+ */
+#include "../sw_event.h"
+#include "../sw_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+enum { MAX_CASES = 64, MSG_SIZE = 4096 };
+
+static char expected[MAX_CASES][MSG_SIZE];
+static char logged[MAX_CASES][MSG_SIZE];
+static int expected_count = 0;
+static int logged_count = 0;
+
+static void OnLog(int level, const char *msg)
+{
+    if (logged_count < MAX_CASES)
+    {
+        snprintf(logged[logged_count++], MSG_SIZE, "%s", msg);
+    }
+}
+
+#define CHECK(...) \
+    do { \
+        snprintf(expected[expected_count++], MSG_SIZE, __VA_ARGS__); \
+        sw_log_error(__VA_ARGS__); \
+    } while (0)
+
+int main()
+{
+    char unterminated[4] = {'a', 'b', 'c', 'd'};
+    int n = 0;
+    int failed = 0;
+    int i;
+    sw_set_log_func(OnLog);
+    if (-1 == sw_log_async_start(0))
+    {
+        printf("sw_log_async_start failed\n");
+        return 1;
+    }
+    CHECK("plain text");
+    CHECK("%d %i %5d %-5d| %+d %05d", -42, 7, 123, 45, 6, -78);
+    CHECK("%hhd %hd %ld %lld %zd %jd %td", (signed char)-3, (short)-300, -70000L,
+          -5000000000LL, (size_t)12345, (intmax_t)-9, (ptrdiff_t)-10);
+    CHECK("%o %u %x %X %#x %#o", 8u, 4000000000u, 255u, 255u, 255u, 8u);
+    CHECK("%hhu %hu %lu %llu %zu %ju %tx", (unsigned char)250, (unsigned short)65000,
+          4000000000UL, 18000000000000000000ULL, (size_t)99, (uintmax_t)77, (ptrdiff_t)31);
+    CHECK("%c%c%c", 'a', 'b', 'c');
+    CHECK("%f %.2f %e %E %g %G %a %A %F", 3.14159, 2.5, 12345.678, 0.000123, 1e10, 1e-10,
+          1.0, 0.5, 7.0);
+    CHECK("%Lf %.3Le %Lg", (long double)1.25, (long double)99.5, (long double)0.1);
+    CHECK("%*d|%-*d|%.*f|%*.*f", 6, 42, 6, 42, 3, 1.23456, 10, 2, 3.14159);
+    CHECK("%s|%10s|%-10s|%.3s|", "hello", "right", "left", "truncate");
+    CHECK("%.*s|%.4s|%.*s", 4, unterminated, unterminated, -1, "negative precision");
+    CHECK("%p %p", (void *)&n, (void *)NULL);
+    CHECK("100%% done, %d%%", 50);
+    CHECK("%d%n after n", 5, &n);
+    sw_log_async_stop();
+    if (logged_count != expected_count)
+    {
+        printf("logged %d messages, expected %d\n", logged_count, expected_count);
+        return 1;
+    }
+    for (i = 0; i < expected_count; ++i)
+    {
+        if (0 != strcmp(expected[i], logged[i]))
+        {
+            printf("mismatch: expected \"%s\", logged \"%s\"\n", expected[i], logged[i]);
+            failed = 1;
+        }
+    }
+    printf("%d messages checked, %s\n", expected_count, failed ? "FAILED" : "ok");
+    return failed;
+}